@@ -0,0 +1,521 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* posix */
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/inotify.h>
+
+/* thirdparty */
+#include <zlib.h>
+#include <clog.h>
+#include <pcaio/pcaio.h>
+#include <pcaio/modio.h>
+#include <chttp/chttp.h>
+
+/* local public */
+#include "carrot/server.h"
+#include "carrot/connection.h"
+
+/* local private */
+#include "common.h"
+#include "server.h"
+#include "static.h"
+#include "encoding.h"
+#include "header.h"
+#include "pool.h"
+#include "asset.h"
+
+
+#define WATCHMASK (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVED_FROM | \
+        IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+
+/* FNV-1a */
+static uint32_t
+_hash(const struct static_dir *dir, const char *path) {
+    uint32_t h = 2166136261u ^ (uint32_t)(uintptr_t)dir;
+
+    while (*path) {
+        h ^= (unsigned char)*path++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+
+static uint64_t
+_hash64(const char *buff, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+
+    while (len--) {
+        h ^= (unsigned char)*buff++;
+        h *= 1099511628211ull;
+    }
+
+    return h;
+}
+
+
+static void
+_lru_unlink(struct assetcache *ac, struct asset *a) {
+    if (a->prev) {
+        a->prev->next = a->next;
+    }
+    else {
+        ac->head = a->next;
+    }
+
+    if (a->next) {
+        a->next->prev = a->prev;
+    }
+    else {
+        ac->tail = a->prev;
+    }
+
+    a->prev = NULL;
+    a->next = NULL;
+}
+
+
+static void
+_lru_push(struct assetcache *ac, struct asset *a) {
+    a->prev = NULL;
+    a->next = ac->head;
+    if (ac->head) {
+        ac->head->prev = a;
+    }
+    ac->head = a;
+    if (ac->tail == NULL) {
+        ac->tail = a;
+    }
+}
+
+
+static void
+_asset_free(struct asset *a) {
+    free(a->path);
+    free(a->header);
+    free(a->content);
+    free(a->gzheader);
+    free(a->gzcontent);
+    free(a);
+}
+
+
+/* remove the asset from the cache, it will be freed after the last
+ * pending write of it is done */
+static void
+_remove(struct assetcache *ac, struct asset *a) {
+    struct asset **cur;
+
+    for (cur = &ac->buckets[a->hash % ASSETCACHE_BUCKETS]; *cur;
+            cur = &(*cur)->hnext) {
+        if (*cur == a) {
+            *cur = a->hnext;
+            break;
+        }
+    }
+
+    _lru_unlink(ac, a);
+    ac->used -= a->memsize;
+    a->linked = 0;
+
+    if (a->refs == 0) {
+        _asset_free(a);
+    }
+}
+
+
+struct assetcache *
+assetcache_new(size_t budget, size_t filemax) {
+    struct assetcache *ac;
+
+    ac = calloc(1, sizeof(struct assetcache));
+    if (ac == NULL) {
+        return NULL;
+    }
+
+    ac->inotifyfd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (ac->inotifyfd == -1) {
+        free(ac);
+        return NULL;
+    }
+
+    ac->budget = budget;
+    ac->filemax = filemax;
+    return ac;
+}
+
+
+void
+assetcache_free(struct assetcache *ac) {
+    if (ac == NULL) {
+        return;
+    }
+
+    while (ac->head) {
+        _remove(ac, ac->head);
+    }
+
+    close(ac->inotifyfd);
+    free(ac);
+}
+
+
+struct asset *
+assetcache_get(struct assetcache *ac, const struct static_dir *dir,
+        const char *path) {
+    struct asset *a;
+    uint32_t hash = _hash(dir, path);
+
+    for (a = ac->buckets[hash % ASSETCACHE_BUCKETS]; a; a = a->hnext) {
+        if ((a->hash == hash) && (a->dir == dir) &&
+                (strcmp(a->path, path) == 0)) {
+            _lru_unlink(ac, a);
+            _lru_push(ac, a);
+            return a;
+        }
+    }
+
+    return NULL;
+}
+
+
+static int
+_gzip(const char *in, size_t inlen, char **out, size_t *outlen) {
+    z_stream zs;
+    size_t bound;
+
+    memset(&zs, 0, sizeof(zs));
+
+    /* 16 + MAX_WBITS: gzip header and trailer */
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+
+    bound = deflateBound(&zs, inlen);
+    *out = malloc(bound);
+    if (*out == NULL) {
+        deflateEnd(&zs);
+        return -1;
+    }
+
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = inlen;
+    zs.next_out = (Bytef *)*out;
+    zs.avail_out = bound;
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        deflateEnd(&zs);
+        free(*out);
+        *out = NULL;
+        return -1;
+    }
+
+    *outlen = zs.total_out;
+    deflateEnd(&zs);
+    return 0;
+}
+
+
+static char *
+_header_render(struct asset *a, const char *type, size_t contentlen,
+        const char *encoding, size_t *len) {
+    int bytes;
+    char *header;
+
+    /* the variants are differ in Content-Encoding */
+    bytes = asprintf(&header, "%s"
+            "Content-Type: %s\r\n"
+            "Content-Length: %zu\r\n"
+            "Last-Modified: %s\r\n"
+            "ETag: %s\r\n"
+            "Accept-Ranges: bytes\r\n"
+            "%s%s%s%s",
+            header_statusline(200, NULL), type, contentlen, a->lastmodified,
+            a->etag, encoding? "Content-Encoding: ": "",
+            encoding? encoding: "", encoding? "\r\n": "",
+            a->gzcontent? "Vary: Accept-Encoding\r\n": "");
+    if (bytes == -1) {
+        return NULL;
+    }
+
+    *len = bytes;
+    return header;
+}
+
+
+static int
+_watch(struct assetcache *ac, struct asset *a) {
+    char dirpath[PATH_MAX];
+    const char *slash;
+    int len;
+
+    slash = strrchr(a->path, '/');
+    if (slash) {
+        len = snprintf(dirpath, sizeof(dirpath), "%s/%.*s", a->dir->root,
+                (int)(slash - a->path), a->path);
+        a->name = slash + 1;
+    }
+    else {
+        len = snprintf(dirpath, sizeof(dirpath), "%s", a->dir->root);
+        a->name = a->path;
+    }
+
+    ASSRT(len < sizeof(dirpath));
+    a->wd = inotify_add_watch(ac->inotifyfd, dirpath, WATCHMASK);
+    if (a->wd == -1) {
+        WARN("inotify_add_watch: %s", dirpath);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/** read the whole file into memory, render the headers and the gzip
+ * variant and put it in the cache. returns NULL if the file is too big or
+ * cannot be watched for changes.
+ */
+struct asset *
+assetcache_load(struct assetcache *ac, const struct static_dir *dir,
+        const char *path, int fd, const struct stat *st) {
+    struct asset *a;
+    struct tm tm;
+    const char *type = static_contenttype(path);
+    ssize_t bytes;
+    size_t total = 0;
+    uint32_t hash;
+
+    if ((st->st_size > ac->filemax) || (st->st_size > ac->budget)) {
+        return NULL;
+    }
+
+    a = calloc(1, sizeof(struct asset));
+    if (a == NULL) {
+        return NULL;
+    }
+
+    a->dir = dir;
+    a->path = strdup(path);
+    a->contentlen = st->st_size;
+    a->content = malloc(a->contentlen? a->contentlen: 1);
+    if ((a->path == NULL) || (a->content == NULL)) {
+        goto failed;
+    }
+
+    while (total < a->contentlen) {
+        bytes = pread(fd, a->content + total, a->contentlen - total, total);
+        if (bytes <= 0) {
+            goto failed;
+        }
+        total += bytes;
+    }
+
+    /* validators */
+    a->mtime = st->st_mtime;
+    gmtime_r(&a->mtime, &tm);
+    strftime(a->lastmodified, sizeof(a->lastmodified), STATIC_HTTPDATE, &tm);
+    snprintf(a->etag, sizeof(a->etag), "\"%016llx\"",
+            (unsigned long long)_hash64(a->content, a->contentlen));
+
+    /* precompressed variant, only if it's smaller */
+    if (encoding_compressible(type) && (a->contentlen > 0) &&
+            (_gzip(a->content, a->contentlen, &a->gzcontent,
+                   &a->gzcontentlen) == 0) &&
+            (a->gzcontentlen >= a->contentlen)) {
+        free(a->gzcontent);
+        a->gzcontent = NULL;
+        a->gzcontentlen = 0;
+    }
+
+    a->header = _header_render(a, type, a->contentlen, NULL, &a->headerlen);
+    if (a->header == NULL) {
+        goto failed;
+    }
+
+    if (a->gzcontent) {
+        a->gzheader = _header_render(a, type, a->gzcontentlen, "gzip",
+                &a->gzheaderlen);
+        if (a->gzheader == NULL) {
+            goto failed;
+        }
+    }
+
+    a->memsize = sizeof(struct asset) + strlen(a->path) + a->headerlen +
+        a->contentlen + a->gzheaderlen + a->gzcontentlen;
+    if (a->memsize > ac->budget) {
+        goto failed;
+    }
+
+    if (_watch(ac, a)) {
+        goto failed;
+    }
+
+    /* evict the least recently used assets */
+    while (ac->tail && ((ac->used + a->memsize) > ac->budget)) {
+        _remove(ac, ac->tail);
+    }
+
+    hash = _hash(dir, path);
+    a->hash = hash;
+    a->hnext = ac->buckets[hash % ASSETCACHE_BUCKETS];
+    ac->buckets[hash % ASSETCACHE_BUCKETS] = a;
+    _lru_push(ac, a);
+    ac->used += a->memsize;
+    a->linked = 1;
+    return a;
+
+failed:
+    _asset_free(a);
+    return NULL;
+}
+
+
+static void
+_invalidate(struct assetcache *ac, const struct inotify_event *e) {
+    struct asset *a;
+    struct asset *next;
+
+    for (a = ac->head; a; a = next) {
+        next = a->next;
+
+        /* queue overflow: everything, directory events: all the files */
+        if ((e->mask & IN_Q_OVERFLOW) || ((a->wd == e->wd) &&
+                    ((e->len == 0) || (strcmp(a->name, e->name) == 0)))) {
+            DEBUG("asset invalidated: %s", a->path);
+            _remove(ac, a);
+        }
+    }
+}
+
+
+/** invalidate the cached assets of the changed files, without waiting for
+ * the events. returns -1 on error.
+ */
+int
+assetcache_notify(struct assetcache *ac) {
+    char buff[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *e;
+    ssize_t bytes;
+    char *ptr;
+
+    for (;;) {
+        bytes = read(ac->inotifyfd, buff, sizeof(buff));
+        if (bytes == -1) {
+            if (!RETRY(errno)) {
+                return -1;
+            }
+
+            errno = 0;
+            return 0;
+        }
+
+        for (ptr = buff; ptr < (buff + bytes);
+                ptr += sizeof(struct inotify_event) + e->len) {
+            e = (const struct inotify_event *)ptr;
+            _invalidate(ac, e);
+        }
+    }
+}
+
+
+static int
+_notmodified(struct carrot_connection *c, struct asset *a) {
+    struct chttp_request *req = c->request;
+    const char *header;
+
+    header = chttp_headerset_get(&req->headers, "If-None-Match");
+    if (header) {
+        return strstr(header, a->etag) || (strcmp(header, "*") == 0);
+    }
+
+    header = chttp_headerset_get(&req->headers, "If-Modified-Since");
+    return header && (strcmp(header, a->lastmodified) == 0);
+}
+
+
+/** send the cached asset using a single writev. the asset is referenced
+ * while the write is suspended, because it may be invalidated or evicted
+ * meanwhile.
+ */
+int
+asset_serveA(struct carrot_connection *c, struct asset *a) {
+    struct iovec v[5];
+    int vcount = 5;
+    const char *connection = server_connectionheader(c);
+    int head = c->method == CARROT_METHOD_HEAD;
+    char buff[256];
+    int len;
+    ssize_t bytes;
+
+    if (_notmodified(c, a)) {
+        len = snprintf(buff, sizeof(buff), "%s%s%s"
+                "Last-Modified: %s\r\n"
+                "ETag: %s\r\n\r\n",
+                header_statusline(304, NULL), server_dateheader(c),
+                connection, a->lastmodified, a->etag);
+        ASSRT(len < sizeof(buff));
+        ERR(carrot_connection_writeA(c, buff, len) == -1);
+        return 0;
+    }
+
+    if (a->gzcontent && encoding_accepts(chttp_headerset_get(
+                    &c->request->headers, "Accept-Encoding"), "gzip")) {
+        v[0].iov_base = a->gzheader;
+        v[0].iov_len = a->gzheaderlen;
+        v[4].iov_base = a->gzcontent;
+        v[4].iov_len = a->gzcontentlen;
+    }
+    else {
+        v[0].iov_base = a->header;
+        v[0].iov_len = a->headerlen;
+        v[4].iov_base = a->content;
+        v[4].iov_len = a->contentlen;
+    }
+
+    v[1].iov_base = (void *)connection;
+    v[1].iov_len = strlen(connection);
+    v[2].iov_base = (void *)header_date(&CONN(c)->server->date,
+            &v[2].iov_len);
+    v[3].iov_base = "\r\n";
+    v[3].iov_len = 2;
+    if (head) {
+        vcount--;
+    }
+
+    a->refs++;
+    bytes = carrot_connection_writevA(c, v, vcount);
+    a->refs--;
+    if ((a->refs == 0) && (!a->linked)) {
+        _asset_free(a);
+    }
+
+    return (bytes == -1)? -1: 0;
+}
@@ -0,0 +1,114 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_ASSET_H_
+#define CARROT_ASSET_H_
+
+
+/* standard */
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* posix */
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* local public */
+#include "carrot/connection.h"
+
+/* local private */
+#include "static.h"
+
+
+#define ASSETCACHE_BUCKETS 1024
+
+
+struct asset {
+    /* hash table chain and lru list */
+    struct asset *hnext;
+    struct asset *prev;
+    struct asset *next;
+
+    const struct static_dir *dir;
+    uint32_t hash;
+    int linked;
+    int refs;
+    int wd;
+    char *path;
+    const char *name;
+    size_t memsize;
+
+    /* validators */
+    time_t mtime;
+    char lastmodified[32];
+    char etag[20];
+
+    /* rendered header block, without the Connection and Date headers and
+     * the final CRLF, and the content. plus the gzip variant, if any. */
+    char *header;
+    size_t headerlen;
+    char *content;
+    size_t contentlen;
+    char *gzheader;
+    size_t gzheaderlen;
+    char *gzcontent;
+    size_t gzcontentlen;
+};
+
+
+struct assetcache {
+    size_t budget;
+    size_t filemax;
+    size_t used;
+    int inotifyfd;
+
+    /* most recently used first */
+    struct asset *head;
+    struct asset *tail;
+    struct asset *buckets[ASSETCACHE_BUCKETS];
+};
+
+
+struct assetcache *
+assetcache_new(size_t budget, size_t filemax);
+
+
+void
+assetcache_free(struct assetcache *ac);
+
+
+struct asset *
+assetcache_get(struct assetcache *ac, const struct static_dir *dir,
+        const char *path);
+
+
+struct asset *
+assetcache_load(struct assetcache *ac, const struct static_dir *dir,
+        const char *path, int fd, const struct stat *st);
+
+
+int
+assetcache_notify(struct assetcache *ac);
+
+
+int
+asset_serveA(struct carrot_connection *c, struct asset *a);
+
+
+#endif  // CARROT_ASSET_H_
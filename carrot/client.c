@@ -36,6 +36,7 @@
 
 /* local private */
 #include "common.h"
+#include "headscan.h"
 #include "client.h"
 
 
@@ -95,6 +96,16 @@ carrot_client_connectA(struct carrot_connection *c,
     /* preserve the host address and freeup the address info linked list */
     c->fd = fd;
     c->peer = *peer;
+    c->out = NULL;
+    c->onprogress = NULL;
+    c->corked = 0;
+    c->bodyremain = 0;
+    c->chunkremain = 0;
+    c->bodymax = 0;
+    c->bodyreceived = 0;
+    c->bodyfd = -1;
+    c->method = CARROT_METHOD_UNKNOWN;
+    headscan_reset(&c->scan);
     saddr_tostr(host, sizeof(host), peer);
     INFO("Connected: %s", host);
     freeaddrinfo(result);
@@ -120,7 +131,7 @@ carrot_client_waitresponseA(struct carrot_connection *c) {
     ssize_t hlen;
 
     /* read header */
-    hlen = carrot_connection_recvsearchA(c, "\r\n\r\n");
+    hlen = carrot_connection_recvheaderA(c, 0);
     ERR(hlen <= 0);
     hlen += 2;
 
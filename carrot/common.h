@@ -28,5 +28,10 @@
 #define ERR(c) if (c) return -1
 #define ASSRT(c) if (!(c)) return -1
 
+/* the counters are written by the owner worker only, and read by the
+ * others for the carrot_server_stats() */
+#define STAT_ADD(v, n) __atomic_fetch_add(&(v), (n), __ATOMIC_RELAXED)
+#define STAT_SUB(v, n) __atomic_fetch_sub(&(v), (n), __ATOMIC_RELAXED)
+
 
 #endif  // CARROT_COMMON_H_
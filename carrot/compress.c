@@ -0,0 +1,182 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+
+/* local private */
+#include "common.h"
+#include "encoding.h"
+#include "compress.h"
+
+
+static const char *_names[COMPRESS_CODINGS] = {
+    [COMPRESS_GZIP] = "gzip",
+    [COMPRESS_DEFLATE] = "deflate",
+};
+
+
+void
+compresspool_deinit(struct compresspool *p) {
+    int i;
+    struct compressor *z;
+
+    for (i = 0; i < COMPRESS_CODINGS; i++) {
+        while (p->free[i]) {
+            z = p->free[i];
+            p->free[i] = z->next;
+            deflateEnd(&z->zs);
+            free(z);
+        }
+    }
+    p->count = 0;
+}
+
+
+/** returns a ready to use compressor of the given coding, the idle ones are
+ * reset instead of allocating a new deflate state per response.
+ */
+struct compressor *
+compressor_get(struct compresspool *p, enum compress_coding coding,
+        int level) {
+    struct compressor *z;
+    int wbits;
+
+    z = p->free[coding];
+    if (z) {
+        p->free[coding] = z->next;
+        p->count--;
+        if (deflateReset(&z->zs) != Z_OK) {
+            deflateEnd(&z->zs);
+            free(z);
+            return NULL;
+        }
+        z->len = 0;
+        return z;
+    }
+
+    z = malloc(sizeof(struct compressor));
+    if (z == NULL) {
+        return NULL;
+    }
+
+    /* gzip wrapper, or the zlib one which is what the deflate coding means
+     * (RFC 9110 section 8.4.1.2) */
+    wbits = (coding == COMPRESS_GZIP)? 16 + MAX_WBITS: MAX_WBITS;
+    z->zs.zalloc = Z_NULL;
+    z->zs.zfree = Z_NULL;
+    z->zs.opaque = Z_NULL;
+    if (deflateInit2(&z->zs, level, Z_DEFLATED, wbits, 8,
+                Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(z);
+        return NULL;
+    }
+
+    z->coding = coding;
+    z->next = NULL;
+    z->len = 0;
+    return z;
+}
+
+
+/** give the compressor back to the pool, at most max idle compressors are
+ * kept.
+ */
+void
+compressor_put(struct compresspool *p, struct compressor *z,
+        unsigned int max) {
+    if (p->count >= max) {
+        deflateEnd(&z->zs);
+        free(z);
+        return;
+    }
+
+    z->next = p->free[z->coding];
+    p->free[z->coding] = z;
+    p->count++;
+}
+
+
+/** select the content coding of the response using the Accept-Encoding
+ * header, gzip is preferred.
+ */
+enum compress_coding
+compress_negotiate(const char *acceptencoding) {
+    int i;
+
+    if (acceptencoding == NULL) {
+        return COMPRESS_NONE;
+    }
+
+    for (i = 0; i < COMPRESS_CODINGS; i++) {
+        if (encoding_accepts(acceptencoding, _names[i])) {
+            return i;
+        }
+    }
+
+    return COMPRESS_NONE;
+}
+
+
+const char *
+compress_codingname(enum compress_coding coding) {
+    return _names[coding];
+}
+
+
+/** returns true if len bytes of input are guaranteed to be compressed into
+ * the free space of the output buffer at once.
+ */
+int
+compressor_fits(struct compressor *z, size_t len) {
+    return deflateBound(&z->zs, len) <= (COMPRESS_BUFFSIZE - z->len);
+}
+
+
+void
+compressor_input(struct compressor *z, const void *in, size_t len) {
+    z->zs.next_in = (Bytef *)in;
+    z->zs.avail_in = len;
+}
+
+
+/** compress the pending input into the free space of the output buffer.
+ * flush is one of the Z_NO_FLUSH, Z_SYNC_FLUSH (everything written so far
+ * can be decoded by the peer) or Z_FINISH. returns 1 if the buffer is full
+ * and must be drained before calling again, 0 when done and -1 on error.
+ */
+int
+compressor_run(struct compressor *z, int flush) {
+    int ret;
+
+    z->zs.next_out = (Bytef *)z->buff + z->len;
+    z->zs.avail_out = COMPRESS_BUFFSIZE - z->len;
+    ret = deflate(&z->zs, flush);
+    z->len = COMPRESS_BUFFSIZE - z->zs.avail_out;
+
+    if (ret == Z_STREAM_ERROR) {
+        return -1;
+    }
+
+    if (ret == Z_STREAM_END) {
+        return 0;
+    }
+
+    /* the output is complete only if the deflate did not run out of space */
+    return z->zs.avail_out == 0;
+}
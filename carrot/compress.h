@@ -0,0 +1,94 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_COMPRESS_H_
+#define CARROT_COMPRESS_H_
+
+
+/* standard */
+#include <stddef.h>
+
+/* thirdparty */
+#include <zlib.h>
+
+
+#define COMPRESS_BUFFSIZE 16384
+
+
+enum compress_coding {
+    COMPRESS_NONE = -1,
+    COMPRESS_GZIP = 0,
+    COMPRESS_DEFLATE,
+    COMPRESS_CODINGS,
+};
+
+
+/* deflate stream and it's output buffer, the compressed bytes are appended
+ * to the buff until drained by the caller (len = 0) */
+struct compressor {
+    struct compressor *next;
+    enum compress_coding coding;
+    z_stream zs;
+    size_t len;
+    char buff[COMPRESS_BUFFSIZE];
+};
+
+
+/* per worker free lists of the initialized compressors, one per coding,
+ * because the window bits cannot be changed by the deflateReset() */
+struct compresspool {
+    struct compressor *free[COMPRESS_CODINGS];
+    unsigned int count;
+};
+
+
+void
+compresspool_deinit(struct compresspool *p);
+
+
+struct compressor *
+compressor_get(struct compresspool *p, enum compress_coding coding,
+        int level);
+
+
+void
+compressor_put(struct compresspool *p, struct compressor *z,
+        unsigned int max);
+
+
+enum compress_coding
+compress_negotiate(const char *acceptencoding);
+
+
+const char *
+compress_codingname(enum compress_coding coding);
+
+
+int
+compressor_fits(struct compressor *z, size_t len);
+
+
+void
+compressor_input(struct compressor *z, const void *in, size_t len);
+
+
+int
+compressor_run(struct compressor *z, int flush);
+
+
+#endif  // CARROT_COMPRESS_H_
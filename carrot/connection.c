@@ -18,8 +18,16 @@
  */
 /* standard */
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 
+/* posix */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+
 /* thirdparty */
 #include <mrb.h>
 #include <chttp/chttp.h>
@@ -31,6 +39,12 @@
 
 /* local private */
 #include "common.h"
+#include "headscan.h"
+#include "search.h"
+
+
+/* maximum bytes moved through the pipe at once, the default pipe size */
+#define SPLICE_MAX 65536
 
 
 /** read as much as possible from the peer and returns length of the newly
@@ -70,9 +84,31 @@ retry:
 }
 
 
+/* search for the s, using the vectorized kernel for the header
+ * terminator. */
+static ssize_t
+_search(const char *chunk, size_t chunksize, const char *s, int slen) {
+    const char *found;
+
+    if ((slen == 4) && (memcmp(s, "\r\n\r\n", 4) == 0)) {
+        return search_crlfcrlf(chunk, chunksize);
+    }
+
+    found = memmem(chunk, chunksize, s, slen);
+    if (found == NULL) {
+        return -1;
+    }
+
+    return found - chunk;
+}
+
+
 /** wait until read error, buffer become full or find the s inside the input
  * buffer.
  * search inside the circular buffer for the given expression.
+ * the search is incremental, bytes already searched by the previous calls are
+ * not visited again, so the caller must consume the input up to the found
+ * offset before searching again.
  * returns:
  *  0: EOF and not found
  * -1: read error
@@ -82,12 +118,11 @@ retry:
  */
 ssize_t
 carrot_connection_recvsearchA(struct carrot_connection *c, const char *s) {
-    size_t avail;
-    char *chunk = mrb_readerptr(&c->ring);
-    ssize_t chunksize = mrb_used(&c->ring);
+    size_t used;
+    size_t start;
+    ssize_t found;
+    ssize_t bytes;
     int slen;
-    char *found;
-    int lookbehind;
 
     if (s == NULL) {
         return -3;
@@ -98,35 +133,79 @@ carrot_connection_recvsearchA(struct carrot_connection *c, const char *s) {
         return -3;
     }
 
-    if (chunksize) {
-        found = memmem(chunk, chunksize, s, slen);
-        if (found) {
-            return found - chunk;
+    for (;;) {
+        used = mrb_used(&c->ring);
+        start = MIN(c->scan.scanned, used);
+        if ((used - start) >= (size_t)slen) {
+            found = _search(mrb_readerptr(&c->ring) + start, used - start, s,
+                    slen);
+            if (found >= 0) {
+                c->scan.scanned = 0;
+                return start + found;
+            }
+
+            /* a partial match may be at the tail */
+            c->scan.scanned = used - slen + 1;
         }
-    }
 
-    while ((avail = mrb_available(&c->ring))) {
-        lookbehind = MIN(mrb_used(&c->ring), slen - 1);
-        chunksize = carrot_connection_recvallA(c, &chunk);
-        if (chunksize < 0) {
-            return chunksize;
+        if (mrb_available(&c->ring) == 0) {
+            return -2;
         }
 
-        if (chunksize && (chunksize < slen)) {
-            continue;
+        bytes = carrot_connection_recvallA(c, NULL);
+        if (bytes <= 0) {
+            return bytes;
         }
+    }
+}
+
 
-        found = memmem(chunk - lookbehind, chunksize, s, slen);
-        if (found) {
-            return found - mrb_readerptr(&c->ring);
+/** wait until the whole header is received, each line is validated once as
+ * it arrives, so a malformed or oversized header is detected without waiting
+ * for the rest of it.
+ * returns:
+ *  0: EOF and not found
+ * -1: read error
+ * -2: header is larger than the maxsize or the input buffer
+ * -3: malformed header
+ *  n: offset of the terminating "\r\n\r\n", like the recvsearchA.
+ * the state is kept on failure, so the caller may replace the input buffer
+ * with a larger one holding the same data and call it again.
+ */
+ssize_t
+carrot_connection_recvheaderA(struct carrot_connection *c, size_t maxsize) {
+    size_t headerlen;
+    ssize_t bytes;
+    enum headscan_status status;
+
+    for (;;) {
+        status = headscan_feed(&c->scan, mrb_readerptr(&c->ring),
+                mrb_used(&c->ring), maxsize, &headerlen);
+        if (status != HEADSCAN_MORE) {
+            break;
+        }
+
+        if (mrb_available(&c->ring) == 0) {
+            status = HEADSCAN_TOOLARGE;
+            break;
         }
 
-        if (chunksize == 0) {
-            return 0;
+        bytes = carrot_connection_recvallA(c, NULL);
+        if (bytes <= 0) {
+            return bytes;
         }
     }
 
-    return -2;
+    if (status == HEADSCAN_TOOLARGE) {
+        return -2;
+    }
+
+    if (status == HEADSCAN_MALFORMED) {
+        return -3;
+    }
+
+    headscan_reset(&c->scan);
+    return headerlen;
 }
 
 
@@ -146,6 +225,9 @@ carrot_connection_recvchunkA(struct carrot_connection *c, const char **start) {
 retry:
     chunksize = chttp_chunked_parse(in, inlen, start, &garbage);
     if (chunksize == 0) {
+        /* termination chunk */
+        mrb_skip(&c->ring, garbage);
+        c->bodyremain = 0;
         return 0;
     }
 
@@ -169,21 +251,507 @@ retry:
 }
 
 
+/* wait for a CRLF terminated line at the beginning of the input buffer,
+ * returns the line length including the CRLF, -1 on error, EOF or a bare LF
+ * and -2 when the buffer is full. */
+static ssize_t
+_recvlineA(struct carrot_connection *c) {
+    char *start;
+    char *lf;
+    ssize_t bytes;
+
+    for (;;) {
+        start = mrb_readerptr(&c->ring);
+        lf = memchr(start, '\n', mrb_used(&c->ring));
+        if (lf) {
+            if ((lf == start) || (lf[-1] != '\r')) {
+                return -1;
+            }
+
+            return lf - start + 1;
+        }
+
+        bytes = carrot_connection_recvallA(c, NULL);
+        if (bytes == 0) {
+            return -1;
+        }
+
+        if (bytes < 0) {
+            return bytes;
+        }
+    }
+}
+
+
+/* consume the chunk-size line, and the CRLF of the previous chunk if any.
+ * the trailer section is consumed after the last chunk. returns the chunk
+ * size, -1 on error or a malformed chunk and -2 when the buffer is full. */
+static ssize_t
+_chunksizeA(struct carrot_connection *c) {
+    ssize_t line;
+    const char *p;
+    size_t size = 0;
+    ssize_t i;
+    int digit;
+
+    if (c->bodyreceived) {
+        line = _recvlineA(c);
+        if (line != 2) {
+            return (line < 0)? line: -1;
+        }
+        mrb_skip(&c->ring, 2);
+    }
+
+    line = _recvlineA(c);
+    if (line < 0) {
+        return line;
+    }
+
+    p = mrb_readerptr(&c->ring);
+    for (i = 0; i < (line - 2); i++) {
+        if ((p[i] >= '0') && (p[i] <= '9')) {
+            digit = p[i] - '0';
+        }
+        else if (((p[i] | 0x20) >= 'a') && ((p[i] | 0x20) <= 'f')) {
+            digit = (p[i] | 0x20) - 'a' + 10;
+        }
+        else {
+            break;
+        }
+
+        if (size > (SSIZE_MAX >> 4)) {
+            return -1;
+        }
+        size = (size << 4) | digit;
+    }
+
+    /* chunk extensions are ignored */
+    if ((i == 0) || ((i < (line - 2)) && (p[i] != ';') && (p[i] != ' ') &&
+                (p[i] != '\t'))) {
+        return -1;
+    }
+    mrb_skip(&c->ring, line);
+
+    /* trailer fields, until the empty line */
+    while (size == 0) {
+        line = _recvlineA(c);
+        if (line < 0) {
+            return line;
+        }
+
+        mrb_skip(&c->ring, line);
+        if (line == 2) {
+            break;
+        }
+    }
+
+    return size;
+}
+
+
+/* length of the rest of a length-delimited body or the current chunk,
+ * the chunk-size line is consumed when a new chunk is expected. returns 0 at
+ * the end of the body, or a negative value like the recvbodyA. */
+static ssize_t
+_bodyremainA(struct carrot_connection *c) {
+    ssize_t size;
+
+    if (c->bodyremain >= 0) {
+        return c->bodyremain;
+    }
+
+    if (c->chunkremain) {
+        return c->chunkremain;
+    }
+
+    size = _chunksizeA(c);
+    if (size == 0) {
+        c->bodyremain = 0;
+    }
+
+    if (size <= 0) {
+        return size;
+    }
+
+    c->bodyreceived += size;
+    if (c->bodymax && (c->bodyreceived > c->bodymax)) {
+        return -3;
+    }
+
+    c->chunkremain = size;
+    return size;
+}
+
+
+static void
+_bodyconsume(struct carrot_connection *c, size_t bytes) {
+    if (c->bodyremain > 0) {
+        c->bodyremain -= bytes;
+        c->bodyreceived += bytes;
+    }
+    else {
+        c->chunkremain -= bytes;
+    }
+}
+
+
+/** yields the next segment of the request body as soon as it arrives, for
+ * both the length-delimited and the chunked bodies. the start is set to the
+ * segment inside the input buffer, which is consumed to free up the space
+ * and is valid until the next read from the connection.
+ * returns:
+ *  n: length of the segment
+ *  0: end of the body
+ * -1: error, EOF or malformed chunk
+ * -2: input buffer is full, the chunk-size line is too long
+ * -3: body is larger than the bodymax
+ */
+ssize_t
+carrot_connection_recvbodyA(struct carrot_connection *c, const char **start) {
+    ssize_t remain;
+    size_t used;
+    ssize_t bytes;
+
+    remain = _bodyremainA(c);
+    if (remain <= 0) {
+        return remain;
+    }
+
+    used = mrb_used(&c->ring);
+    if (used == 0) {
+        bytes = carrot_connection_recvallA(c, NULL);
+        if (bytes <= 0) {
+            return -1;
+        }
+        used = bytes;
+    }
+
+    bytes = MIN(used, (size_t)remain);
+    *start = mrb_readerptr(&c->ring);
+    mrb_skip(&c->ring, bytes);
+    _bodyconsume(c, bytes);
+    return bytes;
+}
+
+
+/* move at most len bytes from the socket to the file through the pipe,
+ * without copying them to the user-space */
+static ssize_t
+_spliceA(struct carrot_connection *c, int pipefd[2], int fd, size_t len) {
+    ssize_t bytes;
+    ssize_t moved;
+    size_t remain;
+
+retry:
+    bytes = splice(c->fd, NULL, pipefd[1], NULL, MIN(len, SPLICE_MAX),
+            SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (bytes == 0) {
+        return -1;
+    }
+
+    if (bytes == -1) {
+        if (!RETRY(errno)) {
+            return -1;
+        }
+
+        if (pcaio_modio_await(c->fd, IOIN)) {
+            return -1;
+        }
+
+        errno = 0;
+        goto retry;
+    }
+
+    /* the pipe is drained entirely, so it never blocks the socket side */
+    for (remain = bytes; remain; remain -= moved) {
+        moved = splice(pipefd[0], NULL, fd, NULL, remain, SPLICE_F_MOVE);
+        if (moved <= 0) {
+            return -1;
+        }
+    }
+
+    return bytes;
+}
+
+
+/** receive the rest of the request body into a new unnamed file inside the
+ * dir (O_TMPFILE), the part which is already buffered is written and the
+ * rest is spliced from the socket, so the memory usage does not depend on
+ * the body size. the file is rewound and it's descriptor is stored in the
+ * bodyfd, which is closed by the server after the handler.
+ * returns the number of bytes written to the file, or a negative value like
+ * the recvbodyA.
+ */
+ssize_t
+carrot_connection_recvfileA(struct carrot_connection *c, const char *dir) {
+    int fd;
+    int pipefd[2];
+    ssize_t remain;
+    ssize_t bytes;
+    size_t total = 0;
+    size_t used;
+
+    fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (pipe2(pipefd, O_NONBLOCK | O_CLOEXEC)) {
+        close(fd);
+        return -1;
+    }
+
+    while ((remain = _bodyremainA(c)) > 0) {
+        used = mrb_used(&c->ring);
+        if (used) {
+            bytes = write(fd, mrb_readerptr(&c->ring),
+                    MIN(used, (size_t)remain));
+            if (bytes <= 0) {
+                remain = -1;
+                break;
+            }
+            mrb_skip(&c->ring, bytes);
+        }
+        else {
+            bytes = _spliceA(c, pipefd, fd, remain);
+            if (bytes < 0) {
+                remain = -1;
+                break;
+            }
+        }
+
+        _bodyconsume(c, bytes);
+        total += bytes;
+    }
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+    if (remain || lseek(fd, 0, SEEK_SET)) {
+        close(fd);
+        return remain? remain: -1;
+    }
+
+    if (c->bodyfd != -1) {
+        close(c->bodyfd);
+    }
+    c->bodyfd = fd;
+    return total;
+}
+
+
+static inline void
+_progress(struct carrot_connection *c) {
+    if (c->onprogress) {
+        c->onprogress(c);
+    }
+}
+
+
+/* wait until the socket become writable */
+static int
+_writableA(struct carrot_connection *c) {
+    if (!RETRY(errno)) {
+        return -1;
+    }
+
+    errno = 0;
+    return pcaio_modio_await(c->fd, IOOUT);
+}
+
+
+static void
+_iovec_advance(struct iovec **v, int *vcount, size_t bytes) {
+    while (bytes && *vcount) {
+        if (bytes < (*v)->iov_len) {
+            (*v)->iov_base += bytes;
+            (*v)->iov_len -= bytes;
+            return;
+        }
+
+        bytes -= (*v)->iov_len;
+        (*v)++;
+        (*vcount)--;
+    }
+}
+
+
+/** send the queued output, wait for the socket to become writable if
+ * needed. returns the number of bytes written or -1 on error.
+ */
+ssize_t
+carrot_connection_flushA(struct carrot_connection *c) {
+    size_t total = 0;
+    ssize_t written;
+
+    if (c->out == NULL) {
+        return 0;
+    }
+
+    while (mrb_used(c->out)) {
+        written = write(c->fd, mrb_readerptr(c->out), mrb_used(c->out));
+        if (written == -1) {
+            ERR(_writableA(c));
+            continue;
+        }
+
+        ERR(mrb_skip(c->out, written));
+        total += written;
+        _progress(c);
+    }
+
+    return total;
+}
+
+
+static int
+_enqueue(struct mrb *out, struct iovec *v, int vcount, size_t totallen) {
+    int i;
+
+    if (mrb_available(out) < totallen) {
+        return -1;
+    }
+
+    for (i = 0; i < vcount; i++) {
+        if (mrb_put(out, v[i].iov_base, v[i].iov_len)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* the vector before the v is reserved for the queued output */
+static ssize_t
+_writevA(struct carrot_connection *c, struct iovec *v, int vcount,
+        size_t totallen) {
+    size_t remain;
+    size_t queued;
+    ssize_t written;
+
+    if (c->out && c->corked && (_enqueue(c->out, v, vcount, totallen) == 0)) {
+        return totallen;
+    }
+
+    remain = totallen;
+    while (remain) {
+        queued = c->out? mrb_used(c->out): 0;
+        v[-1].iov_base = queued? mrb_readerptr(c->out): NULL;
+        v[-1].iov_len = queued;
+
+        written = writev(c->fd, v - 1, vcount + 1);
+        if (written == -1) {
+            ERR(_writableA(c));
+            continue;
+        }
+
+        _progress(c);
+        if (queued) {
+            queued = MIN((size_t)written, queued);
+            ERR(mrb_skip(c->out, queued));
+            written -= queued;
+        }
+
+        _iovec_advance(&v, &vcount, written);
+        remain -= written;
+        if (remain == 0) {
+            break;
+        }
+
+        /* retain the rest */
+        if (c->out && (_enqueue(c->out, v, vcount, remain) == 0)) {
+            break;
+        }
+
+        /* backpressure */
+        errno = EAGAIN;
+        ERR(_writableA(c));
+    }
+
+    return totallen;
+}
+
+
+/** send the packet along with the queued output, if any, using a single
+ * writev. the unsent part of the packet is retained in the output queue and
+ * will be sent by the next packet or carrot_connection_flushA(). when the
+ * queue is full, waits for the socket to become writable, so the streaming
+ * handlers are slowed down to the peer's speed.
+ */
 ssize_t
 carrot_connection_sendpacketA(struct carrot_connection *c,
         struct chttp_packet *p) {
-    struct iovec v[4];
-    int vcount = sizeof(v) / sizeof(struct iovec);
+    struct iovec v[5];
+    int vcount = (sizeof(v) / sizeof(struct iovec)) - 1;
     size_t totallen;
-    size_t written;
 
-    totallen = chttp_packet_iovec(p, v, &vcount);
-    written = writevA(c->fd, v, vcount);
-    if (written != totallen) {
-        // TODO: write the rest of the buffer later after pcaio_relaxA
+    totallen = chttp_packet_iovec(p, v + 1, &vcount);
+    ERR(_writevA(c, v + 1, vcount, totallen) == -1);
+    chttp_packet_reset(p);
+    return totallen;
+}
+
+
+/** same as the carrot_connection_sendpacketA() but for a raw buffer.
+ */
+ssize_t
+carrot_connection_writeA(struct carrot_connection *c, const void *buff,
+        size_t len) {
+    struct iovec v[2];
+
+    v[1].iov_base = (void *)buff;
+    v[1].iov_len = len;
+    return _writevA(c, v + 1, 1, len);
+}
+
+
+/** same as the carrot_connection_sendpacketA() but for the given vectors.
+ */
+ssize_t
+carrot_connection_writevA(struct carrot_connection *c,
+        const struct iovec *v, int vcount) {
+    int i;
+    size_t totallen = 0;
+    struct iovec vectors[CARROT_CONNECTION_IOVMAX + 1];
+
+    if (vcount > CARROT_CONNECTION_IOVMAX) {
         return -1;
     }
 
-    chttp_packet_reset(p);
-    return totallen;
+    for (i = 0; i < vcount; i++) {
+        vectors[i + 1] = v[i];
+        totallen += v[i].iov_len;
+    }
+
+    return _writevA(c, vectors + 1, vcount, totallen);
+}
+
+
+/** flush the output queue and send count bytes of the file using sendfile
+ * from the given offset. returns the number of bytes sent or -1 on error.
+ */
+ssize_t
+carrot_connection_sendfileA(struct carrot_connection *c, int fd,
+        off_t offset, size_t count) {
+    size_t total = 0;
+    ssize_t bytes;
+
+    ERR(carrot_connection_flushA(c) == -1);
+    while (total < count) {
+        bytes = sendfile(c->fd, fd, &offset, count - total);
+        if (bytes == -1) {
+            ERR(_writableA(c));
+            continue;
+        }
+
+        if (bytes == 0) {
+            /* file is truncated */
+            return -1;
+        }
+
+        total += bytes;
+        _progress(c);
+    }
+
+    return total;
 }
@@ -0,0 +1,139 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+#include <string.h>
+
+/* posix */
+#include <strings.h>
+
+/* local private */
+#include "common.h"
+#include "encoding.h"
+
+
+/** returns true if the Accept-Encoding header value allows the given
+ * content coding, explicitly or using the * wildcard, with a non-zero
+ * q-value.
+ */
+int
+encoding_accepts(const char *acceptencoding, const char *coding) {
+    const char *token;
+    const char *end;
+    const char *q;
+    size_t len;
+    size_t codinglen = strlen(coding);
+    int wildcard = 0;
+
+    if (acceptencoding == NULL) {
+        return 0;
+    }
+
+    for (token = acceptencoding; token; token = strchr(token, ',')) {
+        while ((token[0] == ',') || (token[0] == ' ')) {
+            token++;
+        }
+
+        end = token + strcspn(token, ",;");
+        len = end - token;
+        while (len && (token[len - 1] == ' ')) {
+            len--;
+        }
+
+        /* q-value */
+        q = NULL;
+        if (end[0] == ';') {
+            q = strstr(end, "q=");
+            if (q && (q > (end + strcspn(end, ",")))) {
+                q = NULL;
+            }
+        }
+
+        if (((len == codinglen) && (strncasecmp(token, coding, len) == 0)) ||
+                ((len == 1) && (token[0] == '*'))) {
+            if (q && (strtod(q + 2, NULL) == 0)) {
+                if (len != 1) {
+                    /* explicitly refused */
+                    return 0;
+                }
+                continue;
+            }
+
+            if (len != 1) {
+                return 1;
+            }
+            wildcard = 1;
+        }
+    }
+
+    return wildcard;
+}
+
+
+/** returns true if the comma separated list of a header value, e.g. the
+ * Connection, contains the token, case-insensitively. parameters are
+ * ignored.
+ */
+int
+encoding_hastoken(const char *list, const char *token) {
+    const char *end;
+    size_t len;
+    size_t tokenlen = strlen(token);
+
+    if (list == NULL) {
+        return 0;
+    }
+
+    for (; list; list = strchr(list, ',')) {
+        while ((list[0] == ',') || (list[0] == ' ') || (list[0] == '\t')) {
+            list++;
+        }
+
+        end = list + strcspn(list, ",;");
+        len = end - list;
+        while (len && ((list[len - 1] == ' ') || (list[len - 1] == '\t'))) {
+            len--;
+        }
+
+        if ((len == tokenlen) && (strncasecmp(list, token, len) == 0)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/** returns true if compressing the content type worth it.
+ */
+int
+encoding_compressible(const char *contenttype) {
+    if (contenttype == NULL) {
+        return 0;
+    }
+
+    if (strncmp(contenttype, "text/", 5) == 0) {
+        return 1;
+    }
+
+    return (strstr(contenttype, "json") != NULL) ||
+        (strstr(contenttype, "javascript") != NULL) ||
+        (strstr(contenttype, "xml") != NULL) ||
+        (strstr(contenttype, "wasm") != NULL);
+}
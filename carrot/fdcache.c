@@ -0,0 +1,315 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/* posix */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* local private */
+#include "common.h"
+#include "static.h"
+#include "fdcache.h"
+
+
+/* FNV-1a */
+static uint32_t
+_hash(const struct static_dir *dir, const char *path) {
+    uint32_t h = 2166136261u ^ (uint32_t)(uintptr_t)dir;
+
+    while (*path) {
+        h ^= (unsigned char)*path++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+
+static unsigned long
+_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL;
+}
+
+
+static void
+_lru_unlink(struct fdcache *fc, struct fdentry *e) {
+    if (e->prev) {
+        e->prev->next = e->next;
+    }
+    else {
+        fc->head = e->next;
+    }
+
+    if (e->next) {
+        e->next->prev = e->prev;
+    }
+    else {
+        fc->tail = e->prev;
+    }
+
+    e->prev = NULL;
+    e->next = NULL;
+}
+
+
+static void
+_lru_push(struct fdcache *fc, struct fdentry *e) {
+    e->prev = NULL;
+    e->next = fc->head;
+    if (fc->head) {
+        fc->head->prev = e;
+    }
+    fc->head = e;
+    if (fc->tail == NULL) {
+        fc->tail = e;
+    }
+}
+
+
+static void
+_entry_free(struct fdentry *e) {
+    close(e->fd);
+    free(e);
+}
+
+
+/** remove the entry from the cache. the file will be closed after the last
+ * reference is released.
+ */
+static void
+_unlink(struct fdcache *fc, struct fdentry *e) {
+    struct fdentry **cur;
+
+    for (cur = &fc->buckets[e->hash % FDCACHE_BUCKETS]; *cur;
+            cur = &(*cur)->hnext) {
+        if (*cur == e) {
+            *cur = e->hnext;
+            break;
+        }
+    }
+
+    _lru_unlink(fc, e);
+    e->linked = 0;
+    fc->count--;
+
+    if (e->refs == 0) {
+        _entry_free(e);
+    }
+}
+
+
+struct fdcache *
+fdcache_new(unsigned int max, unsigned int ttl) {
+    struct fdcache *fc;
+
+    fc = calloc(1, sizeof(struct fdcache));
+    if (fc == NULL) {
+        return NULL;
+    }
+
+    fc->max = max;
+    fc->ttl = ttl;
+    return fc;
+}
+
+
+void
+fdcache_free(struct fdcache *fc) {
+    if (fc == NULL) {
+        return;
+    }
+
+    while (fc->head) {
+        _unlink(fc, fc->head);
+    }
+
+    free(fc);
+}
+
+
+/** close up to count unused files, least recently used first. returns the
+ * number of closed files.
+ */
+unsigned int
+fdcache_shrink(struct fdcache *fc, unsigned int count) {
+    unsigned int closed = 0;
+    struct fdentry *e;
+    struct fdentry *prev;
+
+    for (e = fc->tail; e && (closed < count); e = prev) {
+        prev = e->prev;
+        if (e->refs) {
+            continue;
+        }
+
+        _unlink(fc, e);
+        closed++;
+    }
+
+    return closed;
+}
+
+
+static int
+_openat(struct fdcache *fc, const struct static_dir *dir, const char *path) {
+    int fd;
+
+    fd = static_open(dir, path);
+    if ((fd == -1) && ((errno == EMFILE) || (errno == ENFILE)) &&
+            fdcache_shrink(fc, 1)) {
+        fd = static_open(dir, path);
+    }
+
+    return fd;
+}
+
+
+static struct fdentry *
+_lookup(struct fdcache *fc, const struct static_dir *dir, const char *path,
+        uint32_t hash) {
+    struct fdentry *e;
+
+    for (e = fc->buckets[hash % FDCACHE_BUCKETS]; e; e = e->hnext) {
+        if ((e->hash == hash) && (e->dir == dir) &&
+                (strcmp(e->path, path) == 0)) {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+
+/** returns true if the file is replaced, modified or removed since the
+ * entry is created.
+ */
+static int
+_stale(struct fdentry *e) {
+    struct stat st;
+
+    if (fstatat(e->dir->rootfd, e->path, &st, 0)) {
+        errno = 0;
+        return 1;
+    }
+
+    return (st.st_ino != e->st.st_ino) || (st.st_dev != e->st.st_dev) ||
+        (st.st_size != e->st.st_size) || (st.st_mtime != e->st.st_mtime);
+}
+
+
+/** returns a referenced entry of the regular file at the path relative to
+ * the static directory, or NULL with errno set on failure. the entry must
+ * be released using the fdcache_release(). the cached metadata is trusted
+ * for ttl milliseconds, then the path is checked again.
+ */
+struct fdentry *
+fdcache_open(struct fdcache *fc, const struct static_dir *dir,
+        const char *path) {
+    struct fdentry *e;
+    size_t pathlen;
+    uint32_t hash = _hash(dir, path);
+    unsigned long now = _now();
+
+    e = _lookup(fc, dir, path, hash);
+    if (e) {
+        if ((now - e->checked) < fc->ttl) {
+            goto found;
+        }
+
+        if (!_stale(e)) {
+            e->checked = now;
+            goto found;
+        }
+
+        _unlink(fc, e);
+    }
+
+    pathlen = strlen(path);
+    e = malloc(sizeof(struct fdentry) + pathlen + 1);
+    if (e == NULL) {
+        return NULL;
+    }
+
+    e->fd = _openat(fc, dir, path);
+    if (e->fd == -1) {
+        free(e);
+        return NULL;
+    }
+
+    if (fstat(e->fd, &e->st) || (!S_ISREG(e->st.st_mode))) {
+        close(e->fd);
+        free(e);
+        errno = ENOENT;
+        return NULL;
+    }
+
+    e->dir = dir;
+    e->hash = hash;
+    e->refs = 0;
+    e->linked = 0;
+    e->prev = NULL;
+    e->next = NULL;
+    e->hnext = NULL;
+    e->checked = now;
+    e->type = static_contenttype(path);
+    memcpy(e->path, path, pathlen + 1);
+
+    /* make a room, all the cached files may be in use */
+    if (fc->count >= fc->max) {
+        fdcache_shrink(fc, fc->count - fc->max + 1);
+    }
+
+    if (fc->count >= fc->max) {
+        /* not cached, will be closed after release */
+        e->refs++;
+        return e;
+    }
+
+    e->hnext = fc->buckets[hash % FDCACHE_BUCKETS];
+    fc->buckets[hash % FDCACHE_BUCKETS] = e;
+    e->linked = 1;
+    fc->count++;
+    _lru_push(fc, e);
+    e->refs++;
+    return e;
+
+found:
+    _lru_unlink(fc, e);
+    _lru_push(fc, e);
+    e->refs++;
+    return e;
+}
+
+
+void
+fdcache_release(struct fdcache *fc, struct fdentry *e) {
+    e->refs--;
+    if ((e->refs == 0) && (!e->linked)) {
+        _entry_free(e);
+    }
+}
@@ -0,0 +1,92 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_FDCACHE_H_
+#define CARROT_FDCACHE_H_
+
+
+/* standard */
+#include <stdint.h>
+
+/* posix */
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* local private */
+#include "static.h"
+
+
+#define FDCACHE_BUCKETS 1024
+
+
+struct fdentry {
+    /* hash table chain and lru list */
+    struct fdentry *hnext;
+    struct fdentry *prev;
+    struct fdentry *next;
+
+    const struct static_dir *dir;
+    uint32_t hash;
+    int linked;
+    int refs;
+
+    /* the open file, it's metadata and the resolved content type */
+    int fd;
+    struct stat st;
+    const char *type;
+
+    /* the last time (CLOCK_MONOTONIC, ms) the path is checked */
+    unsigned long checked;
+    char path[];
+};
+
+
+struct fdcache {
+    unsigned int max;
+    unsigned int count;
+    unsigned int ttl;
+
+    /* most recently used first */
+    struct fdentry *head;
+    struct fdentry *tail;
+    struct fdentry *buckets[FDCACHE_BUCKETS];
+};
+
+
+struct fdcache *
+fdcache_new(unsigned int max, unsigned int ttl);
+
+
+void
+fdcache_free(struct fdcache *fc);
+
+
+struct fdentry *
+fdcache_open(struct fdcache *fc, const struct static_dir *dir,
+        const char *path);
+
+
+void
+fdcache_release(struct fdcache *fc, struct fdentry *e);
+
+
+unsigned int
+fdcache_shrink(struct fdcache *fc, unsigned int count);
+
+
+#endif  // CARROT_FDCACHE_H_
@@ -0,0 +1,145 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* local private */
+#include "common.h"
+#include "header.h"
+
+
+#define STATUSLINE(code, text) \
+    {code, "HTTP/1.1 " #code " " text "\r\n", \
+        sizeof("HTTP/1.1 " #code " " text "\r\n") - 1}
+
+
+static const struct {
+    int status;
+    const char *line;
+    size_t len;
+} _statuslines[] = {
+    STATUSLINE(200, "OK"),
+    STATUSLINE(201, "Created"),
+    STATUSLINE(202, "Accepted"),
+    STATUSLINE(204, "No Content"),
+    STATUSLINE(206, "Partial Content"),
+    STATUSLINE(301, "Moved Permanently"),
+    STATUSLINE(302, "Found"),
+    STATUSLINE(303, "See Other"),
+    STATUSLINE(304, "Not Modified"),
+    STATUSLINE(307, "Temporary Redirect"),
+    STATUSLINE(308, "Permanent Redirect"),
+    STATUSLINE(400, "Bad Request"),
+    STATUSLINE(401, "Unauthorized"),
+    STATUSLINE(403, "Forbidden"),
+    STATUSLINE(404, "Not Found"),
+    STATUSLINE(405, "Method Not Allowed"),
+    STATUSLINE(408, "Request Timeout"),
+    STATUSLINE(411, "Length Required"),
+    STATUSLINE(413, "Content Too Large"),
+    STATUSLINE(416, "Range Not Satisfiable"),
+    STATUSLINE(429, "Too Many Requests"),
+    STATUSLINE(431, "Request Header Fields Too Large"),
+    STATUSLINE(500, "Internal Server Error"),
+    STATUSLINE(501, "Not Implemented"),
+    STATUSLINE(502, "Bad Gateway"),
+    STATUSLINE(503, "Service Unavailable"),
+    STATUSLINE(504, "Gateway Timeout"),
+};
+
+
+/** returns the pre-rendered status line of the common status codes,
+ * including the CRLF, or NULL if the status is not a common one.
+ */
+const char *
+header_statusline(int status, size_t *len) {
+    int i;
+
+    for (i = 0; i < (sizeof(_statuslines) / sizeof(_statuslines[0])); i++) {
+        if (_statuslines[i].status == status) {
+            if (len) {
+                *len = _statuslines[i].len;
+            }
+            return _statuslines[i].line;
+        }
+    }
+
+    return NULL;
+}
+
+
+/** returns the Date header line, including the CRLF. it's rendered again
+ * only when the second changes, according to the coarse realtime clock.
+ */
+const char *
+header_date(struct header_date *d, size_t *len) {
+    struct timespec ts;
+    struct tm tm;
+
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    if ((ts.tv_sec != d->sec) || (d->len == 0)) {
+        gmtime_r(&ts.tv_sec, &tm);
+        d->len = strftime(d->line, sizeof(d->line),
+                "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        d->sec = ts.tv_sec;
+    }
+
+    if (len) {
+        *len = d->len;
+    }
+    return d->line;
+}
+
+
+/** render the NULL terminated list of the header lines into a single
+ * block, each line terminated by a CRLF. the result must be freed by the
+ * caller.
+ */
+char *
+header_block(const char *const *headers, size_t *len) {
+    int i;
+    size_t total = 0;
+    size_t linelen;
+    char *block;
+    char *cursor;
+
+    for (i = 0; headers[i]; i++) {
+        total += strlen(headers[i]) + 2;
+    }
+
+    block = malloc(total + 1);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    cursor = block;
+    for (i = 0; headers[i]; i++) {
+        linelen = strlen(headers[i]);
+        memcpy(cursor, headers[i], linelen);
+        cursor += linelen;
+        memcpy(cursor, "\r\n", 2);
+        cursor += 2;
+    }
+    cursor[0] = 0;
+
+    *len = total;
+    return block;
+}
@@ -0,0 +1,52 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_HEADER_H_
+#define CARROT_HEADER_H_
+
+
+/* standard */
+#include <stddef.h>
+#include <time.h>
+
+
+/* Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n */
+#define HEADER_DATESIZE 40
+
+
+/* per worker Date header, rendered at most once per second */
+struct header_date {
+    time_t sec;
+    size_t len;
+    char line[HEADER_DATESIZE];
+};
+
+
+const char *
+header_statusline(int status, size_t *len);
+
+
+const char *
+header_date(struct header_date *d, size_t *len);
+
+
+char *
+header_block(const char *const *headers, size_t *len);
+
+
+#endif  // CARROT_HEADER_H_
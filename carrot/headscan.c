@@ -0,0 +1,135 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* local private */
+#include "search.h"
+#include "headscan.h"
+
+
+/* the tchar of the RFC 9110, the control characters of the lines are found
+ * by the vectorized search */
+static const unsigned char _tokens[256] = {
+    ['!'] = 1,
+    ['#' ... '\''] = 1,
+    ['*' ... '+'] = 1,
+    ['-' ... '.'] = 1,
+    ['0' ... '9'] = 1,
+    ['A' ... 'Z'] = 1,
+    ['^' ... '`'] = 1,
+    ['a' ... 'z'] = 1,
+    ['|'] = 1,
+    ['~'] = 1,
+};
+#define TOKEN(c) _tokens[(unsigned char)(c)]
+
+
+/* field-name ":" field-value, the obsolete line folding is rejected */
+static int
+_fieldline(const char *line, size_t len) {
+    size_t i = 0;
+
+    while ((i < len) && TOKEN(line[i])) {
+        i++;
+    }
+
+    if ((i == 0) || (i == len) || (line[i] != ':')) {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void
+headscan_reset(struct carrot_headerscan *s) {
+    s->scanned = 0;
+    s->line = 0;
+    s->lines = 0;
+}
+
+
+/** validate the newly received lines of the header inside the buff, which
+ * starts at the beginning of the header and holds len bytes, the bytes
+ * visited by the previous calls are not visited again.
+ * HEADSCAN_DONE is returned when the empty line is found and the headerlen is
+ * set to the offset of the terminating "\r\n\r\n".
+ * HEADSCAN_TOOLARGE is returned as soon as the header exceeds the maxsize,
+ * zero: unlimited.
+ */
+enum headscan_status
+headscan_feed(struct carrot_headerscan *s, const char *buff, size_t len,
+        size_t maxsize, size_t *headerlen) {
+    ssize_t found;
+    size_t cr;
+
+    if (maxsize == 0) {
+        maxsize = (size_t)-1;
+    }
+
+    while (s->scanned < len) {
+        /* the start line may not contain an HTAB, the field lines may */
+        found = search_ctl(buff + s->scanned, len - s->scanned, s->lines);
+        if (found == -1) {
+            s->scanned = len;
+            break;
+        }
+
+        cr = s->scanned + found;
+        if ((cr + 1) >= maxsize) {
+            return HEADSCAN_TOOLARGE;
+        }
+
+        /* a bare LF or any other control character */
+        if (buff[cr] != '\r') {
+            return HEADSCAN_MALFORMED;
+        }
+
+        if ((cr + 1) == len) {
+            s->scanned = cr;
+            break;
+        }
+
+        if (buff[cr + 1] != '\n') {
+            return HEADSCAN_MALFORMED;
+        }
+
+        if (cr == s->line) {
+            /* the empty line, the end of the header */
+            if (s->lines == 0) {
+                return HEADSCAN_MALFORMED;
+            }
+
+            *headerlen = s->line - 2;
+            return HEADSCAN_DONE;
+        }
+
+        if (s->lines && _fieldline(buff + s->line, cr - s->line)) {
+            return HEADSCAN_MALFORMED;
+        }
+
+        s->lines++;
+        s->line = cr + 2;
+        s->scanned = cr + 2;
+    }
+
+    if (len >= maxsize) {
+        return HEADSCAN_TOOLARGE;
+    }
+
+    return HEADSCAN_MORE;
+}
@@ -0,0 +1,47 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_HEADSCAN_H_
+#define CARROT_HEADSCAN_H_
+
+
+/* standard */
+#include <stddef.h>
+
+/* local public */
+#include "carrot/connection.h"
+
+
+enum headscan_status {
+    HEADSCAN_MORE,
+    HEADSCAN_DONE,
+    HEADSCAN_MALFORMED,
+    HEADSCAN_TOOLARGE,
+};
+
+
+void
+headscan_reset(struct carrot_headerscan *s);
+
+
+enum headscan_status
+headscan_feed(struct carrot_headerscan *s, const char *buff, size_t len,
+        size_t maxsize, size_t *headerlen);
+
+
+#endif  // CARROT_HEADSCAN_H_
@@ -0,0 +1,261 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+
+/* posix */
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* thirdparty */
+#include <clog.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* local private */
+#include "common.h"
+#include "server.h"
+#include "master.h"
+
+
+/* minimum lifetime of a worker process in seconds, the master waits before
+ * restarting workers which crash faster than this, to avoid busy looping. */
+#define WORKER_MINLIFETIME 1
+
+
+static const int _signals[] = {SIGINT, SIGTERM, SIGQUIT, SIGHUP, SIGCHLD};
+#define SIGNALS (sizeof(_signals) / sizeof(int))
+
+
+struct process {
+    pid_t pid;
+    time_t started;
+};
+
+
+static void
+_sigset(sigset_t *set) {
+    int i;
+
+    sigemptyset(set);
+    for (i = 0; i < SIGNALS; i++) {
+        sigaddset(set, _signals[i]);
+    }
+}
+
+
+static int
+_spawn(struct carrot_server *s, struct process *p, unsigned int index,
+        const sigset_t *set) {
+    int ret;
+    pid_t pid;
+    sigset_t unblock;
+
+    pid = fork();
+    if (pid == -1) {
+        ERROR("fork()");
+        return -1;
+    }
+
+    if (pid) {
+        /* master */
+        p->pid = pid;
+        p->started = time(NULL);
+        INFO("worker process #%u started, pid: %d", index, pid);
+        return 0;
+    }
+
+    /* worker process, the signals are blocked by the master. SIGINT and
+     * SIGTERM stay blocked, they are received by the server_run() */
+    unblock = *set;
+    sigdelset(&unblock, SIGINT);
+    sigdelset(&unblock, SIGTERM);
+    sigprocmask(SIG_UNBLOCK, &unblock, NULL);
+    ret = server_run(s);
+    exit(ret? EXIT_FAILURE: EXIT_SUCCESS);
+}
+
+
+static void
+_forward(struct process *processes, unsigned int count, int sig) {
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        if (processes[i].pid > 0) {
+            kill(processes[i].pid, sig);
+        }
+    }
+}
+
+
+/* reap the exited workers and restart the crashed ones, unless stopping.
+ * returns the number of the running workers, or -1 if a worker cannot be
+ * restarted. */
+static int
+_reap(struct carrot_server *s, struct process *processes, unsigned int count,
+        int stopping, const sigset_t *set) {
+    int status;
+    unsigned int i;
+    int running = 0;
+    pid_t pid;
+    struct process *p;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        /* find the exited worker */
+        for (i = 0; i < count; i++) {
+            if (processes[i].pid == pid) {
+                break;
+            }
+        }
+
+        if (i == count) {
+            continue;
+        }
+
+        p = processes + i;
+        p->pid = -1;
+        if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS)) {
+            INFO("worker process #%u exited, pid: %d", i, pid);
+            continue;
+        }
+
+        if (WIFSIGNALED(status)) {
+            ERROR("worker process #%u killed by signal %d, pid: %d", i,
+                    WTERMSIG(status), pid);
+        }
+        else {
+            ERROR("worker process #%u failed, pid: %d", i, pid);
+        }
+
+        if (stopping) {
+            continue;
+        }
+
+        /* restart the crashed worker */
+        if ((time(NULL) - p->started) < WORKER_MINLIFETIME) {
+            sleep(WORKER_MINLIFETIME);
+        }
+
+        if (_spawn(s, p, i, set)) {
+            return -1;
+        }
+    }
+
+    errno = 0;
+
+    for (i = 0; i < count; i++) {
+        if (processes[i].pid > 0) {
+            running++;
+        }
+    }
+
+    return running;
+}
+
+
+/** fork count worker processes, each one binds it's own listen socket
+ * using SO_REUSEPORT, except the unix domain socket which is bound by the
+ * master and shared. restart crashed workers and forward the SIGINT,
+ * SIGTERM and SIGQUIT signals to them. the signals are blocked and
+ * received synchronously along with the SIGCHLD, so none of them is missed
+ * while waiting. returns when all workers are exited.
+ */
+int
+master_main(struct carrot_server *s, unsigned int count) {
+    int ret = 0;
+    int stopping = 0;
+    int sig;
+    int running;
+    unsigned int i;
+    sigset_t set;
+    sigset_t old;
+    struct process *processes;
+
+    processes = calloc(count, sizeof(struct process));
+    if (processes == NULL) {
+        return -1;
+    }
+
+    _sigset(&set);
+    if (sigprocmask(SIG_BLOCK, &set, &old)) {
+        free(processes);
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (_spawn(s, processes + i, i, &set)) {
+            stopping = 1;
+            ret = -1;
+            _forward(processes, count, SIGTERM);
+            break;
+        }
+    }
+
+    for (;;) {
+        running = _reap(s, processes, count, stopping, &set);
+        if (running == -1) {
+            ret = -1;
+            if (!stopping) {
+                stopping = 1;
+                _forward(processes, count, SIGTERM);
+            }
+            continue;
+        }
+
+        if (running == 0) {
+            /* all workers are exited */
+            break;
+        }
+
+        sig = sigwaitinfo(&set, NULL);
+        if (sig == -1) {
+            if (errno == EINTR) {
+                errno = 0;
+                continue;
+            }
+
+            ret = -1;
+            break;
+        }
+
+        if (sig == SIGCHLD) {
+            continue;
+        }
+
+        /* there is no reload, and the workers would die of it */
+        if (sig == SIGHUP) {
+            WARN("SIGHUP ignored, reload is not supported");
+            continue;
+        }
+
+        INFO("forwarding signal %d to worker processes", sig);
+        _forward(processes, count, sig);
+        stopping = 1;
+    }
+
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    free(processes);
+    return ret;
+}
@@ -0,0 +1,152 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+#include <string.h>
+
+/* local public */
+#include "carrot/connection.h"
+
+/* local private */
+#include "common.h"
+#include "method.h"
+
+
+static const struct {
+    enum carrot_method method;
+    const char *verb;
+    size_t len;
+} _methods[] = {
+    {CARROT_METHOD_GET, "GET", 3},
+    {CARROT_METHOD_HEAD, "HEAD", 4},
+    {CARROT_METHOD_POST, "POST", 4},
+    {CARROT_METHOD_PUT, "PUT", 3},
+    {CARROT_METHOD_DELETE, "DELETE", 6},
+    {CARROT_METHOD_PATCH, "PATCH", 5},
+    {CARROT_METHOD_OPTIONS, "OPTIONS", 7},
+    {CARROT_METHOD_CONNECT, "CONNECT", 7},
+    {CARROT_METHOD_TRACE, "TRACE", 5},
+    {CARROT_METHOD_UNKNOWN, NULL, 0},
+};
+
+
+/** map the request verb to the method, the methods are case-sensitive.
+ */
+enum carrot_method
+method_parse(const char *verb) {
+    switch (verb[0]) {
+        case 'G':
+            if (strcmp(verb, "GET") == 0) {
+                return CARROT_METHOD_GET;
+            }
+            break;
+
+        case 'H':
+            if (strcmp(verb, "HEAD") == 0) {
+                return CARROT_METHOD_HEAD;
+            }
+            break;
+
+        case 'P':
+            if (strcmp(verb, "POST") == 0) {
+                return CARROT_METHOD_POST;
+            }
+            if (strcmp(verb, "PUT") == 0) {
+                return CARROT_METHOD_PUT;
+            }
+            if (strcmp(verb, "PATCH") == 0) {
+                return CARROT_METHOD_PATCH;
+            }
+            break;
+
+        case 'D':
+            if (strcmp(verb, "DELETE") == 0) {
+                return CARROT_METHOD_DELETE;
+            }
+            break;
+
+        case 'O':
+            if (strcmp(verb, "OPTIONS") == 0) {
+                return CARROT_METHOD_OPTIONS;
+            }
+            break;
+
+        case 'C':
+            if (strcmp(verb, "CONNECT") == 0) {
+                return CARROT_METHOD_CONNECT;
+            }
+            break;
+
+        case 'T':
+            if (strcmp(verb, "TRACE") == 0) {
+                return CARROT_METHOD_TRACE;
+            }
+            break;
+
+        case 0:
+            return CARROT_METHOD_UNKNOWN;
+    }
+
+    return CARROT_METHOD_EXTENSION;
+}
+
+
+/** render the Allow header line of the methods, including the CRLF. the
+ * HEAD is implied by the GET. the result must be freed by the caller.
+ */
+char *
+method_allow(unsigned int methods, size_t *len) {
+    int i;
+    char *line;
+    size_t total = 0;
+
+    if (methods & CARROT_METHOD_GET) {
+        methods |= CARROT_METHOD_HEAD;
+    }
+
+    line = malloc(sizeof("Allow: \r\n") + sizeof("GET, HEAD, POST, PUT, "
+                "DELETE, PATCH, OPTIONS, CONNECT, TRACE"));
+    if (line == NULL) {
+        return NULL;
+    }
+
+    memcpy(line, "Allow: ", 7);
+    total = 7;
+    for (i = 0; _methods[i].verb; i++) {
+        if (!(methods & _methods[i].method)) {
+            continue;
+        }
+
+        if (total > 7) {
+            memcpy(line + total, ", ", 2);
+            total += 2;
+        }
+
+        memcpy(line + total, _methods[i].verb, _methods[i].len);
+        total += _methods[i].len;
+    }
+
+    memcpy(line + total, "\r\n", 3);
+    total += 2;
+    if (len) {
+        *len = total;
+    }
+
+    return line;
+}
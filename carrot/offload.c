@@ -0,0 +1,330 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+
+/* posix */
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/* thirdparty */
+#include <clog.h>
+#include <pcaio/pcaio.h>
+#include <pcaio/modio.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* local private */
+#include "common.h"
+#include "server.h"
+#include "pool.h"
+#include "offload.h"
+
+
+static void *
+_thread(void *arg) {
+    struct offload *o = arg;
+    struct offload_job *job;
+    int fd;
+
+    pthread_mutex_lock(&o->lock);
+    for (;;) {
+        while ((o->head == NULL) && !o->stopping) {
+            pthread_cond_wait(&o->cond, &o->lock);
+        }
+
+        /* the queued jobs are done before stopping */
+        job = o->head;
+        if (job == NULL) {
+            break;
+        }
+
+        o->head = job->next;
+        if (o->head == NULL) {
+            o->tail = NULL;
+        }
+        o->queued--;
+        o->running++;
+        pthread_mutex_unlock(&o->lock);
+
+        job->status = job->fn(job->arg);
+
+        /* the job may vanish as soon as the coroutine is woken up */
+        fd = job->fd;
+        pthread_mutex_lock(&o->lock);
+        o->running--;
+        o->completed++;
+        job->done = 1;
+        eventfd_write(fd, 1);
+    }
+    pthread_mutex_unlock(&o->lock);
+
+    return NULL;
+}
+
+
+/** start the given number of threads running the offloaded jobs, at most
+ * queuemax jobs are waiting for a free thread, zero: unlimited.
+ */
+struct offload *
+offload_new(unsigned int threads, unsigned int queuemax) {
+    struct offload *o;
+    sigset_t all;
+    sigset_t old;
+
+    o = malloc(sizeof(struct offload) + sizeof(pthread_t) * threads);
+    if (o == NULL) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&o->lock, NULL)) {
+        free(o);
+        return NULL;
+    }
+
+    if (pthread_cond_init(&o->cond, NULL)) {
+        pthread_mutex_destroy(&o->lock);
+        free(o);
+        return NULL;
+    }
+
+    o->head = NULL;
+    o->tail = NULL;
+    o->queuemax = queuemax;
+    o->stopping = 0;
+    o->queued = 0;
+    o->running = 0;
+    o->completed = 0;
+    o->rejected = 0;
+
+    /* signals are handled by the event loop threads */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (o->count = 0; o->count < threads; o->count++) {
+        if (pthread_create(&o->threads[o->count], NULL, _thread, o)) {
+            ERROR("cannot start offload thread #%u", o->count);
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (o->count < threads) {
+        offload_free(o);
+        return NULL;
+    }
+
+    return o;
+}
+
+
+/** stop the threads after the queued jobs are done.
+ */
+void
+offload_free(struct offload *o) {
+    unsigned int i;
+
+    if (o == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&o->lock);
+    o->stopping = 1;
+    pthread_cond_broadcast(&o->cond);
+    pthread_mutex_unlock(&o->lock);
+
+    for (i = 0; i < o->count; i++) {
+        pthread_join(o->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&o->cond);
+    pthread_mutex_destroy(&o->lock);
+    free(o);
+}
+
+
+/** append the job to the queue, returns -1 if the queue is full.
+ */
+int
+offload_submit(struct offload *o, struct offload_job *job) {
+    pthread_mutex_lock(&o->lock);
+    if (o->queuemax && (o->queued >= o->queuemax)) {
+        o->rejected++;
+        pthread_mutex_unlock(&o->lock);
+        return -1;
+    }
+
+    job->next = NULL;
+    if (o->tail) {
+        o->tail->next = job;
+    }
+    else {
+        o->head = job;
+    }
+    o->tail = job;
+    o->queued++;
+    pthread_cond_signal(&o->cond);
+    pthread_mutex_unlock(&o->lock);
+    return 0;
+}
+
+
+/** remove the job from the queue if no thread has taken it yet, returns -1
+ * if it's already running or done.
+ */
+int
+offload_cancel(struct offload *o, struct offload_job *job) {
+    struct offload_job **cur;
+    struct offload_job *prev = NULL;
+
+    pthread_mutex_lock(&o->lock);
+    for (cur = &o->head; *cur; cur = &(*cur)->next) {
+        if (*cur == job) {
+            *cur = job->next;
+            if (o->tail == job) {
+                o->tail = prev;
+            }
+            o->queued--;
+            pthread_mutex_unlock(&o->lock);
+            return 0;
+        }
+        prev = *cur;
+    }
+    pthread_mutex_unlock(&o->lock);
+
+    return -1;
+}
+
+
+void
+offload_waitfds_deinit(struct offload_waitfds *w) {
+    while (w->count) {
+        close(w->list[--w->count]);
+    }
+}
+
+
+static int
+_waitfd_get(struct offload_waitfds *w) {
+    if (w->count) {
+        return w->list[--w->count];
+    }
+
+    return eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+
+static void
+_waitfd_put(struct offload_waitfds *w, int fd) {
+    if (w->count >= OFFLOAD_WAITFDS) {
+        close(fd);
+        return;
+    }
+
+    w->list[w->count++] = fd;
+}
+
+
+/* the wakeup of the job cannot be waited for, take it back if it's still
+ * queued, otherwise poll until the thread is done with it, because the job
+ * lives in the caller's stack. it blocks the worker, but it's the last
+ * resort. */
+static void
+_abandon(struct offload *o, struct offload_job *job) {
+    useconds_t backoff = OFFLOAD_BACKOFFMINUS;
+    int done;
+
+    if (offload_cancel(o, job) == 0) {
+        return;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&o->lock);
+        done = job->done;
+        pthread_mutex_unlock(&o->lock);
+        if (done) {
+            break;
+        }
+
+        usleep(backoff);
+        if (backoff < OFFLOAD_BACKOFFMAXUS) {
+            backoff *= 2;
+        }
+    }
+}
+
+
+/** run the fn(arg) on the offload thread pool and suspend the calling
+ * coroutine until it's done, so the blocking or CPU-heavy work does not
+ * stall the other connections of the worker. returns the fn's return
+ * value, or -1 with the errno set to EAGAIN if the queue is full. the fn
+ * runs in place if the config->offload_threads is zero.
+ */
+int
+carrot_server_offloadA(struct carrot_connection *c, carrot_offload_t fn,
+        void *arg) {
+    struct carrot_server *s = CONN(c)->server;
+    struct offload_job job;
+    eventfd_t val;
+    unsigned int failures = 0;
+
+    if (s->offload == NULL) {
+        return fn(arg);
+    }
+
+    job.fn = fn;
+    job.arg = arg;
+    job.status = -1;
+    job.done = 0;
+    job.fd = _waitfd_get(&s->waitfds);
+    if (job.fd == -1) {
+        return -1;
+    }
+
+    if (offload_submit(s->offload, &job)) {
+        _waitfd_put(&s->waitfds, job.fd);
+        errno = EAGAIN;
+        return -1;
+    }
+
+    /* the job and the arg refer to the caller's stack, so it is waited for
+     * even if the coroutine gets cancelled, yielding to the others instead
+     * of blocking the worker. a few failed awaits are retried, then it's
+     * given up like the read errors. */
+    while (eventfd_read(job.fd, &val)) {
+        if ((errno != EAGAIN) || (failures >= OFFLOAD_AWAITMAX)) {
+            ERROR("cannot wait for the offloaded job");
+            _abandon(s->offload, &job);
+            close(job.fd);
+            return -1;
+        }
+
+        errno = 0;
+        if (pcaio_modio_await(job.fd, IOIN)) {
+            failures++;
+            pcaio_relaxA(0);
+        }
+    }
+
+    _waitfd_put(&s->waitfds, job.fd);
+    return job.status;
+}
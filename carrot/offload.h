@@ -0,0 +1,100 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_OFFLOAD_H_
+#define CARROT_OFFLOAD_H_
+
+
+/* standard */
+#include <pthread.h>
+
+/* local public */
+#include "carrot/server.h"
+
+
+/* idle eventfds kept per worker to wake up the offloading coroutines */
+#define OFFLOAD_WAITFDS 16
+
+/* failed awaits tolerated before giving up waiting for a job */
+#define OFFLOAD_AWAITMAX 8
+
+/* bounds of the backoff of polling a job, given up waiting for */
+#define OFFLOAD_BACKOFFMINUS 100
+#define OFFLOAD_BACKOFFMAXUS 10000
+
+
+/* queued work, it lives in the stack of the suspended coroutine */
+struct offload_job {
+    struct offload_job *next;
+    carrot_offload_t fn;
+    void *arg;
+    int status;
+    int fd;
+
+    /* set by the thread under the lock, before waking up the coroutine */
+    int done;
+};
+
+
+/* process wide pool of threads shared by the workers, the counters are
+ * guarded by the lock */
+struct offload {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct offload_job *head;
+    struct offload_job *tail;
+    unsigned int queuemax;
+    int stopping;
+
+    unsigned long queued;
+    unsigned long running;
+    unsigned long completed;
+    unsigned long rejected;
+
+    unsigned int count;
+    pthread_t threads[];
+};
+
+
+struct offload_waitfds {
+    int list[OFFLOAD_WAITFDS];
+    unsigned int count;
+};
+
+
+struct offload *
+offload_new(unsigned int threads, unsigned int queuemax);
+
+
+void
+offload_free(struct offload *o);
+
+
+int
+offload_submit(struct offload *o, struct offload_job *job);
+
+
+int
+offload_cancel(struct offload *o, struct offload_job *job);
+
+
+void
+offload_waitfds_deinit(struct offload_waitfds *w);
+
+
+#endif  // CARROT_OFFLOAD_H_
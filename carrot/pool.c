@@ -0,0 +1,411 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+#include <string.h>
+
+/* posix */
+#include <unistd.h>
+
+/* thirdparty */
+#include <clog.h>
+#include <mrb.h>
+#include <chttp/chttp.h>
+
+/* local public */
+#include "carrot/server.h"
+#include "carrot/connection.h"
+
+/* local private */
+#include "common.h"
+#include "headscan.h"
+#include "pool.h"
+
+
+#define RINGBYTES(pages) ((size_t)(pages) * getpagesize())
+
+
+/* size class of the ring, or -1 if it's not a power of two pages */
+static int
+_ringclass(unsigned int pages) {
+    int class;
+
+    if ((pages == 0) || (pages & (pages - 1))) {
+        return -1;
+    }
+
+    class = __builtin_ctz(pages);
+    return (class < CONNPOOL_RINGCLASSES)? class: -1;
+}
+
+
+static int
+_ring_get(struct connpool *p, struct mrb *ring, unsigned int pages) {
+    int class = _ringclass(pages);
+    struct ringstack *stack = (class < 0)? NULL: &p->rings[class];
+
+    if (stack && stack->count) {
+        *ring = stack->list[--stack->count];
+        STAT_SUB(p->idle, RINGBYTES(pages));
+    }
+    else if (mrb_init(ring, pages)) {
+        return -1;
+    }
+
+    STAT_ADD(p->attached, RINGBYTES(pages));
+    return 0;
+}
+
+
+static void
+_ring_put(struct connpool *p, struct mrb *ring, unsigned int pages) {
+    int class = _ringclass(pages);
+    struct ringstack *stack = (class < 0)? NULL: &p->rings[class];
+
+    STAT_SUB(p->attached, RINGBYTES(pages));
+    if ((stack == NULL) || (stack->count >= p->capacity)) {
+        mrb_deinit(ring);
+        return;
+    }
+
+    mrb_reset(ring);
+    stack->list[stack->count++] = *ring;
+    STAT_ADD(p->idle, RINGBYTES(pages));
+}
+
+
+static struct chttp_request *
+_request_get(struct connpool *p, const struct carrot_server_config *c) {
+    struct chttp_request *req;
+
+    if (p->requestscount) {
+        req = p->requests[--p->requestscount];
+        STAT_SUB(p->idle, RINGBYTES(c->requestbuffer_mempages));
+    }
+    else {
+        req = chttp_request_new(c->requestbuffer_mempages);
+        if (req == NULL) {
+            return NULL;
+        }
+    }
+
+    STAT_ADD(p->attached, RINGBYTES(c->requestbuffer_mempages));
+    return req;
+}
+
+
+static void
+_request_put(struct connpool *p, const struct carrot_server_config *c,
+        struct chttp_request *req) {
+    STAT_SUB(p->attached, RINGBYTES(c->requestbuffer_mempages));
+    if (p->requestscount >= p->capacity) {
+        free(req);
+        return;
+    }
+
+    chttp_request_reset(req);
+    p->requests[p->requestscount++] = req;
+    STAT_ADD(p->idle, RINGBYTES(c->requestbuffer_mempages));
+}
+
+
+static struct server_conn *
+_conn_new() {
+    struct server_conn *conn;
+
+    conn = malloc(sizeof(struct server_conn));
+    if (conn == NULL) {
+        return NULL;
+    }
+
+    conn->fd = -1;
+    conn->request = NULL;
+    conn->ringpages = 0;
+    conn->out = &conn->outring;
+    conn->corked = 0;
+    conn->onprogress = NULL;
+    conn->bodyremain = 0;
+    conn->chunkremain = 0;
+    conn->bodymax = 0;
+    conn->bodyreceived = 0;
+    conn->bodyfd = -1;
+    conn->method = CARROT_METHOD_UNKNOWN;
+    headscan_reset(&conn->scan);
+    conn->next = NULL;
+    conn->pprev = NULL;
+    conn->idle = 0;
+    conn->timer.next = NULL;
+    conn->timer.pprev = NULL;
+    conn->server = NULL;
+    conn->route = NULL;
+    conn->params.count = 0;
+    return conn;
+}
+
+
+/** the idle buffers, at most bufferpool_size of each kind and size class,
+ * are shared by the connections of the worker. when the
+ * connectionpool_prefault is set, connectionpool_size connections and sets
+ * of buffers are allocated, and the buffer pages are touched to take the
+ * page faults at startup instead of the first request.
+ */
+int
+connpool_init(struct connpool *p, const struct carrot_server_config *c) {
+    struct server_conn *conn;
+    unsigned int i;
+
+    memset(p, 0, sizeof(struct connpool));
+    p->capacity = c->bufferpool_size;
+    if (p->capacity) {
+        for (i = 0; i < CONNPOOL_RINGCLASSES; i++) {
+            p->rings[i].list = calloc(p->capacity, sizeof(struct mrb));
+            if (p->rings[i].list == NULL) {
+                goto failed;
+            }
+        }
+
+        p->outrings.list = calloc(p->capacity, sizeof(struct mrb));
+        p->requests = calloc(p->capacity, sizeof(struct chttp_request *));
+        if ((p->outrings.list == NULL) || (p->requests == NULL)) {
+            goto failed;
+        }
+    }
+
+    if (!c->connectionpool_prefault) {
+        return 0;
+    }
+
+    while (p->count < c->connectionpool_size) {
+        conn = _conn_new();
+        if (conn == NULL) {
+            goto failed;
+        }
+
+        conn->next = p->free;
+        p->free = conn;
+        p->count++;
+
+        /* a set of buffers per connection, up to the bufferpool_size */
+        if (p->count > p->capacity) {
+            continue;
+        }
+
+        if (connpool_attach(p, c, conn)) {
+            goto failed;
+        }
+
+        memset(mrb_writerptr(&conn->ring), 0, mrb_available(&conn->ring));
+        memset(mrb_writerptr(&conn->outring), 0,
+                mrb_available(&conn->outring));
+    }
+
+    /* give the touched buffers to the pool */
+    for (conn = p->free; conn; conn = conn->next) {
+        connpool_detach(p, c, conn);
+    }
+
+    return 0;
+
+failed:
+    connpool_deinit(p);
+    return -1;
+}
+
+
+void
+connpool_deinit(struct connpool *p) {
+    struct server_conn *conn;
+    struct ringstack *stack;
+    unsigned int i;
+
+    while (p->free) {
+        conn = p->free;
+        p->free = conn->next;
+        if (conn->ringpages) {
+            mrb_deinit(&conn->ring);
+            mrb_deinit(&conn->outring);
+            free(conn->request);
+        }
+        free(conn);
+    }
+
+    for (i = 0; i <= CONNPOOL_RINGCLASSES; i++) {
+        stack = (i < CONNPOOL_RINGCLASSES)? &p->rings[i]: &p->outrings;
+        while (stack->count) {
+            mrb_deinit(&stack->list[--stack->count]);
+        }
+        free(stack->list);
+        stack->list = NULL;
+    }
+
+    while (p->requestscount) {
+        free(p->requests[--p->requestscount]);
+    }
+    free(p->requests);
+    p->requests = NULL;
+
+    p->count = 0;
+    p->capacity = 0;
+    p->idle = 0;
+}
+
+
+/** attach the input and output rings and the request buffer to the
+ * connection, from the idle ones if any. the input ring starts with the
+ * connectionbuffer_mempages and may grow later, see connpool_grow().
+ */
+int
+connpool_attach(struct connpool *p, const struct carrot_server_config *c,
+        struct server_conn *conn) {
+    struct chttp_request *req;
+
+    if (conn->ringpages) {
+        return 0;
+    }
+
+    req = _request_get(p, c);
+    if (req == NULL) {
+        return -1;
+    }
+
+    /* the output ring is not pooled by the size class */
+    if (p->outrings.count) {
+        conn->outring = p->outrings.list[--p->outrings.count];
+        STAT_SUB(p->idle, RINGBYTES(c->outputbuffer_mempages));
+    }
+    else if (mrb_init(&conn->outring, c->outputbuffer_mempages)) {
+        _request_put(p, c, req);
+        return -1;
+    }
+    STAT_ADD(p->attached, RINGBYTES(c->outputbuffer_mempages));
+
+    if (_ring_get(p, &conn->ring, c->connectionbuffer_mempages)) {
+        STAT_SUB(p->attached, RINGBYTES(c->outputbuffer_mempages));
+        mrb_deinit(&conn->outring);
+        _request_put(p, c, req);
+        return -1;
+    }
+
+    conn->request = req;
+    conn->ringpages = c->connectionbuffer_mempages;
+    return 0;
+}
+
+
+/** give the buffers back to the pool while the connection is idle, both
+ * rings must be empty.
+ */
+void
+connpool_detach(struct connpool *p, const struct carrot_server_config *c,
+        struct server_conn *conn) {
+    if (conn->ringpages == 0) {
+        return;
+    }
+
+    _ring_put(p, &conn->ring, conn->ringpages);
+    STAT_SUB(p->attached, RINGBYTES(c->outputbuffer_mempages));
+    if (p->outrings.count < p->capacity) {
+        mrb_reset(&conn->outring);
+        p->outrings.list[p->outrings.count++] = conn->outring;
+        STAT_ADD(p->idle, RINGBYTES(c->outputbuffer_mempages));
+    }
+    else {
+        mrb_deinit(&conn->outring);
+    }
+
+    _request_put(p, c, conn->request);
+    conn->request = NULL;
+    conn->ringpages = 0;
+}
+
+
+/** replace the input ring with a larger one of the given pages, preserving
+ * the buffered data. the smaller ring goes back to the pool.
+ */
+int
+connpool_grow(struct connpool *p, struct server_conn *conn,
+        unsigned int pages) {
+    struct mrb ring;
+
+    if (pages <= conn->ringpages) {
+        return 0;
+    }
+
+    if (_ring_get(p, &ring, pages)) {
+        return -1;
+    }
+
+    if (mrb_put(&ring, mrb_readerptr(&conn->ring), mrb_used(&conn->ring))) {
+        _ring_put(p, &ring, pages);
+        return -1;
+    }
+
+    _ring_put(p, &conn->ring, conn->ringpages);
+    conn->ring = ring;
+    conn->ringpages = pages;
+    return 0;
+}
+
+
+struct server_conn *
+connpool_get(struct connpool *p, const struct carrot_server_config *c) {
+    struct server_conn *conn;
+
+    if (p->free == NULL) {
+        return _conn_new();
+    }
+
+    conn = p->free;
+    p->free = conn->next;
+    p->count--;
+    conn->next = NULL;
+    return conn;
+}
+
+
+void
+connpool_put(struct connpool *p, const struct carrot_server_config *c,
+        struct server_conn *conn) {
+    if (conn->bodyfd != -1) {
+        close(conn->bodyfd);
+    }
+
+    connpool_detach(p, c, conn);
+    if (p->count >= c->connectionpool_size) {
+        free(conn);
+        return;
+    }
+
+    /* make everything fresh for the next connection */
+    timer_cancel(&conn->timer);
+    conn->corked = 0;
+    conn->bodyremain = 0;
+    conn->chunkremain = 0;
+    conn->bodymax = 0;
+    conn->bodyreceived = 0;
+    conn->bodyfd = -1;
+    conn->method = CARROT_METHOD_UNKNOWN;
+    headscan_reset(&conn->scan);
+    conn->route = NULL;
+    conn->params.count = 0;
+    conn->fd = -1;
+    conn->next = p->free;
+    p->free = conn;
+    p->count++;
+}
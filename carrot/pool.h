@@ -0,0 +1,138 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_POOL_H_
+#define CARROT_POOL_H_
+
+
+/* local public */
+#include "carrot/server.h"
+#include "carrot/connection.h"
+
+/* local private */
+#include "timer.h"
+#include "router.h"
+
+
+struct carrot_server;
+struct compressor;
+
+
+/* server side connection, the public part must be the first member */
+struct server_conn {
+    struct carrot_connection;
+    struct carrot_server *server;
+
+    /* the free list of the pool, or the open connections of the worker
+     * while in use */
+    struct server_conn *next;
+    struct server_conn **pprev;
+
+    /* waiting for the next request, closed at once when stopping */
+    int idle;
+
+    /* output queue */
+    struct mrb outring;
+
+    /* pages of the input ring, zero: the buffers are detached */
+    unsigned int ringpages;
+
+    /* header, body, idle and write timeouts */
+    struct timer timer;
+    int timedout;
+
+    /* keep-alive */
+    int keepalive;
+    int http10;
+
+    /* the matched route of the current request, if any, and the captured
+     * path parameters */
+    const struct route *route;
+    struct router_params params;
+
+    /* framing and the compressor of the streamed response, if any */
+    int stream;
+    struct compressor *compressor;
+};
+
+
+#define CONN(c) ((struct server_conn *)(c))
+
+
+/* input rings of 1, 2, 4, ... pages are pooled separately */
+#define CONNPOOL_RINGCLASSES 8
+
+
+struct ringstack {
+    struct mrb *list;
+    unsigned int count;
+};
+
+
+/* per worker free list of ready-to-use connections, and the idle buffers
+ * shared by them */
+struct connpool {
+    struct server_conn *free;
+    unsigned int count;
+
+    /* idle buffers, at most capacity of each kind */
+    unsigned int capacity;
+    struct ringstack rings[CONNPOOL_RINGCLASSES];
+    struct ringstack outrings;
+    struct chttp_request **requests;
+    unsigned int requestscount;
+
+    /* bytes of the buffers attached to the connections, and the idle ones */
+    size_t attached;
+    size_t idle;
+};
+
+
+int
+connpool_init(struct connpool *p, const struct carrot_server_config *c);
+
+
+void
+connpool_deinit(struct connpool *p);
+
+
+struct server_conn *
+connpool_get(struct connpool *p, const struct carrot_server_config *c);
+
+
+void
+connpool_put(struct connpool *p, const struct carrot_server_config *c,
+        struct server_conn *conn);
+
+
+int
+connpool_attach(struct connpool *p, const struct carrot_server_config *c,
+        struct server_conn *conn);
+
+
+void
+connpool_detach(struct connpool *p, const struct carrot_server_config *c,
+        struct server_conn *conn);
+
+
+int
+connpool_grow(struct connpool *p, struct server_conn *conn,
+        unsigned int pages);
+
+
+#endif  // CARROT_POOL_H_
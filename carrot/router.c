@@ -17,6 +17,9 @@
  *  Author: Vahid Mardani <vahid.mardani@gmail.com>
  */
 /* standard */
+#include <stdlib.h>
+#include <string.h>
+
 /* thirdparty */
 #include <clog.h>
 
@@ -25,39 +28,433 @@
 
 /* local private */
 #include "common.h"
+#include "method.h"
 #include "router.h"
 
 
-struct route *
-router_find(struct router *rt, const char *verb, const char *path) {
-    int i;
-    struct route *route = NULL;
+static struct router_node *
+_node_new(const char *label, size_t labellen) {
+    struct router_node *n;
+
+    n = calloc(1, sizeof(struct router_node));
+    if (n == NULL) {
+        return NULL;
+    }
+
+    n->label = strndup(label, labellen);
+    if (n->label == NULL) {
+        free(n);
+        return NULL;
+    }
+
+    n->labellen = labellen;
+    return n;
+}
+
+
+static void
+_node_free(struct router_node *n) {
+    struct router_node *child;
+    struct route *r;
+
+    if (n == NULL) {
+        return;
+    }
+
+    while (n->children) {
+        child = n->children;
+        n->children = child->next;
+        _node_free(child);
+    }
+
+    while (n->routes) {
+        r = n->routes;
+        n->routes = r->next;
+        free(r->headers);
+        free(r);
+    }
+
+    _node_free(n->param);
+    _node_free(n->wildcard);
+    free(n->allow);
+    free(n->name);
+    free(n->label);
+    free(n);
+}
+
+
+/* length of the static part, the :param is only allowed at the start of a
+ * path segment, otherwise the colon is a part of the path. */
+static size_t
+_staticlen(const char *pattern) {
+    size_t i;
 
-    for (i = 0; i < rt->count; i++) {
-        route = rt->routes + i;
-        if ((strcmp(route->path, path) == 0)
-                && (strcmp(route->verb, verb) == 0)) {
-                return route;
+    for (i = 1; pattern[i]; i++) {
+        if ((pattern[i] == '*') || ((pattern[i] == ':') && i &&
+                    (pattern[i - 1] == '/'))) {
+            break;
         }
     }
 
-    return NULL;
+    return i;
 }
 
 
-int
-router_append(struct router *rt, const char *verb, const char *path,
+static size_t
+_commonlen(const char *a, size_t alen, const char *b, size_t blen) {
+    size_t i;
+    size_t max = MIN(alen, blen);
+
+    for (i = 0; i < max; i++) {
+        if (a[i] != b[i]) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/* returns the :param or * child, creates it if not exists. the parameter
+ * names of the same position must be equal. */
+static struct router_node *
+_placeholder(struct router_node **slot, const char *name, size_t namelen) {
+    struct router_node *n = *slot;
+
+    if (n) {
+        if ((strlen(n->name) != namelen) ||
+                strncmp(n->name, name, namelen)) {
+            ERROR("conflicting path parameter names: %s, %.*s", n->name,
+                    (int)namelen, name);
+            return NULL;
+        }
+        return n;
+    }
+
+    n = _node_new("", 0);
+    if (n == NULL) {
+        return NULL;
+    }
+
+    n->name = strndup(name, namelen);
+    if (n->name == NULL) {
+        _node_free(n);
+        return NULL;
+    }
+
+    *slot = n;
+    return n;
+}
+
+
+/* returns the node of the pattern, creates the missing nodes and splits
+ * the existing ones if needed */
+static struct router_node *
+_insert(struct router_node *n, const char *pattern) {
+    size_t len;
+    size_t common;
+    struct router_node *child;
+    struct router_node *split;
+
+    while (pattern[0]) {
+        if (pattern[0] == '*') {
+            /* the wildcard captures the rest, must be the last one */
+            len = strlen(pattern + 1);
+            if (strchr(pattern + 1, '/')) {
+                ERROR("the wildcard must be at the end of the path");
+                return NULL;
+            }
+
+            return _placeholder(&n->wildcard, len? pattern + 1: "*",
+                    len? len: 1);
+        }
+
+        if ((pattern[0] == ':') && n->labellen &&
+                (n->label[n->labellen - 1] == '/')) {
+            len = strcspn(pattern + 1, "/");
+            if (len == 0) {
+                ERROR("empty path parameter name");
+                return NULL;
+            }
+
+            n = _placeholder(&n->param, pattern + 1, len);
+            if (n == NULL) {
+                return NULL;
+            }
+
+            pattern += len + 1;
+            continue;
+        }
+
+        len = _staticlen(pattern);
+
+        for (child = n->children; child; child = child->next) {
+            if (child->label[0] == pattern[0]) {
+                break;
+            }
+        }
+
+        if (child == NULL) {
+            child = _node_new(pattern, len);
+            if (child == NULL) {
+                return NULL;
+            }
+
+            child->next = n->children;
+            n->children = child;
+            n = child;
+            pattern += len;
+            continue;
+        }
+
+        common = _commonlen(child->label, child->labellen, pattern, len);
+        if (common < child->labellen) {
+            /* split the child at the end of the common prefix */
+            split = _node_new(child->label, common);
+            if (split == NULL) {
+                return NULL;
+            }
+
+            memmove(child->label, child->label + common,
+                    child->labellen - common + 1);
+            child->labellen -= common;
+            split->children = child;
+            split->next = child->next;
+            child->next = NULL;
+
+            /* replace the child with the split node */
+            if (n->children == child) {
+                n->children = split;
+            }
+            else {
+                struct router_node *prev = n->children;
+
+                while (prev->next != child) {
+                    prev = prev->next;
+                }
+                prev->next = split;
+            }
+            child = split;
+        }
+
+        n = child;
+        pattern += common;
+    }
+
+    return n;
+}
+
+
+struct route *
+router_append(struct router *rt, unsigned int methods, const char *path,
         carrot_handler_t handler, void *ptr) {
+    struct router_node *n;
     struct route *r;
+    struct route **tail;
+    char *allow;
 
-    if (rt->count >= CONFIG_CARROT_SERVER_MAXROUTES) {
-        return -1;
+    if (rt->root == NULL) {
+        rt->root = _node_new("", 0);
+        if (rt->root == NULL) {
+            return NULL;
+        }
+    }
+
+    n = _insert(rt->root, path);
+    if (n == NULL) {
+        return NULL;
+    }
+
+    /* the precomputed Allow header of the 405 responses */
+    allow = method_allow(n->methods | methods, NULL);
+    if (allow == NULL) {
+        return NULL;
     }
 
-    r = &rt->routes[rt->count++];
-    r->verb = verb;
-    r->path = path;
+    r = malloc(sizeof(struct route));
+    if (r == NULL) {
+        free(allow);
+        return NULL;
+    }
+
+    free(n->allow);
+    n->allow = allow;
+    n->methods |= methods;
+    r->next = NULL;
+    r->methods = methods;
     r->handler = handler;
     r->ptr = ptr;
+    r->headers = NULL;
+    r->headerslen = 0;
+    r->bodymax = 0;
+    r->spillover = 0;
+    r->header_maxsize = 0;
+    r->ringpages = 0;
+
+    /* the first registered handler wins */
+    for (tail = &n->routes; *tail; tail = &(*tail)->next) {}
+    *tail = r;
+    return r;
+}
+
+
+/** use the build-time compiled dispatcher before the trie, a route object
+ * is made for each compiled route once here.
+ */
+int
+router_dispatcher(struct router *rt, const struct carrot_dispatcher *d) {
+    unsigned int i;
+    struct route *routes;
+
+    routes = calloc(d->count, sizeof(struct route));
+    if (routes == NULL) {
+        return -1;
+    }
+
+    for (i = 0; i < d->count; i++) {
+        routes[i].methods = d->methods[i];
+        routes[i].handler = d->handlers[i];
+    }
+
+    free(rt->dispatched);
+    rt->dispatched = routes;
+    rt->dispatcher = d;
     return 0;
 }
+
+
+void
+router_deinit(struct router *rt) {
+    _node_free(rt->root);
+    rt->root = NULL;
+    free(rt->dispatched);
+    rt->dispatched = NULL;
+    rt->dispatcher = NULL;
+}
+
+
+/* the GET handler serves the HEAD requests, if there is no HEAD handler */
+static struct route *
+_method(struct router_node *n, enum carrot_method method,
+        const char **allow) {
+    struct route *r;
+
+    if (n->routes == NULL) {
+        return NULL;
+    }
+
+    for (r = n->routes; r; r = r->next) {
+        if (r->methods & method) {
+            return r;
+        }
+    }
+
+    if (method == CARROT_METHOD_HEAD) {
+        for (r = n->routes; r; r = r->next) {
+            if (r->methods & CARROT_METHOD_GET) {
+                return r;
+            }
+        }
+    }
+
+    /* the path is matched, but not the method */
+    if (*allow == NULL) {
+        *allow = n->allow;
+    }
+
+    return NULL;
+}
+
+
+static int
+_capture(struct router_params *params, const char *name, const char *value,
+        size_t len) {
+    if (params->count >= ROUTER_PARAMS_MAX) {
+        return -1;
+    }
+
+    params->list[params->count].name = name;
+    params->list[params->count].value = value;
+    params->list[params->count].len = len;
+    params->count++;
+    return 0;
+}
+
+
+/* depth first search, static children have the priority over the :param
+ * and the * wildcard. the cost is proportional to the path length. */
+static struct route *
+_find(struct router_node *n, enum carrot_method method, const char *path,
+        struct router_params *params, const char **allow) {
+    struct router_node *child;
+    struct route *r;
+    size_t len;
+
+    if (path[0] == 0) {
+        r = _method(n, method, allow);
+        if (r) {
+            return r;
+        }
+    }
+
+    for (child = n->children; child; child = child->next) {
+        if (child->label[0] != path[0]) {
+            continue;
+        }
+
+        if (strncmp(child->label, path, child->labellen) == 0) {
+            r = _find(child, method, path + child->labellen, params, allow);
+            if (r) {
+                return r;
+            }
+        }
+        break;
+    }
+
+    if (n->param) {
+        len = strcspn(path, "/");
+        if (len && (_capture(params, n->param->name, path, len) == 0)) {
+            r = _find(n->param, method, path + len, params, allow);
+            if (r) {
+                return r;
+            }
+            params->count--;
+        }
+    }
+
+    if (n->wildcard) {
+        r = _method(n->wildcard, method, allow);
+        if (r && (_capture(params, n->wildcard->name, path,
+                        strlen(path)) == 0)) {
+            return r;
+        }
+    }
+
+    return NULL;
+}
+
+
+/** returns the route of the method and path, or NULL. if the path is
+ * matched but not the method, the allow is set to the rendered Allow
+ * header of the path, for the 405 responses.
+ */
+struct route *
+router_find(struct router *rt, enum carrot_method method, const char *path,
+        struct router_params *params, const char **allow) {
+    int id;
+
+    params->count = 0;
+    *allow = NULL;
+    if (rt->dispatcher) {
+        id = rt->dispatcher->find(method, path, allow);
+        if (id >= 0) {
+            return rt->dispatched + id;
+        }
+    }
+
+    if (rt->root == NULL) {
+        return NULL;
+    }
+
+    return _find(rt->root, method, path, params, allow);
+}
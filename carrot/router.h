@@ -20,31 +20,101 @@
 #define CARROT_ROUTER_H_
 
 
+/* standard */
+#include <stddef.h>
+
+/* local public */
+#include "carrot/server.h"
+
 /* local private */
 #include "common.h"
 
 
+#define ROUTER_PARAMS_MAX 8
+
+
 struct route {
-    const char *verb;
-    const char *path;
+    /* next handler of the same path with different methods */
+    struct route *next;
+    unsigned int methods;
     carrot_handler_t handler;
     void *ptr;
+
+    /* pre-rendered extra headers, see carrot_route_options */
+    char *headers;
+    size_t headerslen;
+
+    /* maximum request body size, zero: unlimited */
+    size_t bodymax;
+
+    /* spill the larger bodies to a temporary file, zero: disabled */
+    size_t spillover;
+
+    /* see carrot_route_options, zero: disabled */
+    size_t header_maxsize;
+    unsigned int ringpages;
+};
+
+
+/* compressed radix trie node. the static children are matched first, then
+ * the :param and finally the * wildcard child. */
+struct router_node {
+    char *label;
+    size_t labellen;
+
+    /* siblings are sharing the parent but differ in the first character */
+    struct router_node *next;
+    struct router_node *children;
+    struct router_node *param;
+    struct router_node *wildcard;
+
+    /* the name of the :param or * node */
+    char *name;
+    struct route *routes;
+
+    /* all methods of the routes and the rendered Allow header */
+    unsigned int methods;
+    char *allow;
 };
 
 
 struct router {
-    struct route routes[CONFIG_CARROT_SERVER_MAXROUTES];
+    struct router_node *root;
+
+    /* optional compiled routes, looked up before the trie */
+    const struct carrot_dispatcher *dispatcher;
+    struct route *dispatched;
+};
+
+
+/* captured path parameters, the values are pointing to the request path
+ * and are not NULL terminated. */
+struct router_params {
     unsigned char count;
+    struct {
+        const char *name;
+        const char *value;
+        size_t len;
+    } list[ROUTER_PARAMS_MAX];
 };
 
 
 struct route *
-router_find(struct router *rt, const char *verb, const char *path);
+router_find(struct router *rt, enum carrot_method method, const char *path,
+        struct router_params *params, const char **allow);
 
 
-int
-router_append(struct router *rt, const char *verb, const char *path,
+struct route *
+router_append(struct router *rt, unsigned int methods, const char *path,
         carrot_handler_t handler, void *ptr);
 
 
+int
+router_dispatcher(struct router *rt, const struct carrot_dispatcher *d);
+
+
+void
+router_deinit(struct router *rt);
+
+
 #endif  // CARROT_ROUTER_H_
@@ -0,0 +1,261 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <string.h>
+
+/* local private */
+#include "search.h"
+
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+
+/** returns the offset of the first "\r\n\r\n" inside the buffer, or -1.
+ */
+ssize_t
+search_crlfcrlf_scalar(const char *buff, size_t len) {
+    const char *cur = buff;
+    const char *end = buff + len;
+
+    while ((end - cur) >= 4) {
+        cur = memchr(cur, '\r', end - cur - 3);
+        if (cur == NULL) {
+            return -1;
+        }
+
+        if ((cur[1] == '\n') && (cur[2] == '\r') && (cur[3] == '\n')) {
+            return cur - buff;
+        }
+        cur++;
+    }
+
+    return -1;
+}
+
+
+/** returns the offset of the first control character (CTL: 0x00-0x1f and
+ * 0x7f) inside the buffer, or -1. the HTAB is skipped if the tab is set.
+ */
+ssize_t
+search_ctl_scalar(const char *buff, size_t len, int tab) {
+    size_t i;
+    unsigned char c;
+
+    for (i = 0; i < len; i++) {
+        c = buff[i];
+        if ((c == 0x7f) || ((c < 0x20) && !(tab && (c == '\t')))) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* the candidates are the positions where the four shifted loads are all
+ * matching, 16 (sse2) or 32 (avx2) positions per iteration. the tail is
+ * handled by the scalar kernel. */
+__attribute__((target("sse2")))
+ssize_t
+search_crlfcrlf_sse2(const char *buff, size_t len) {
+    size_t i = 0;
+    unsigned int mask;
+    ssize_t found;
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    for (; (i + 16 + 3) <= len; i += 16) {
+        mask = _mm_movemask_epi8(_mm_and_si128(
+                _mm_and_si128(
+                    _mm_cmpeq_epi8(cr, _mm_loadu_si128(
+                            (const __m128i *)(buff + i))),
+                    _mm_cmpeq_epi8(lf, _mm_loadu_si128(
+                            (const __m128i *)(buff + i + 1)))),
+                _mm_and_si128(
+                    _mm_cmpeq_epi8(cr, _mm_loadu_si128(
+                            (const __m128i *)(buff + i + 2))),
+                    _mm_cmpeq_epi8(lf, _mm_loadu_si128(
+                            (const __m128i *)(buff + i + 3))))));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    found = search_crlfcrlf_scalar(buff + i, len - i);
+    return (found == -1)? -1: (ssize_t)(i + found);
+}
+
+
+__attribute__((target("avx2")))
+ssize_t
+search_crlfcrlf_avx2(const char *buff, size_t len) {
+    size_t i = 0;
+    unsigned int mask;
+    ssize_t found;
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+
+    for (; (i + 32 + 3) <= len; i += 32) {
+        mask = _mm256_movemask_epi8(_mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_cmpeq_epi8(cr, _mm256_loadu_si256(
+                            (const __m256i *)(buff + i))),
+                    _mm256_cmpeq_epi8(lf, _mm256_loadu_si256(
+                            (const __m256i *)(buff + i + 1)))),
+                _mm256_and_si256(
+                    _mm256_cmpeq_epi8(cr, _mm256_loadu_si256(
+                            (const __m256i *)(buff + i + 2))),
+                    _mm256_cmpeq_epi8(lf, _mm256_loadu_si256(
+                            (const __m256i *)(buff + i + 3))))));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    /* the legacy sse2 tail stalls on the dirty upper halves */
+    _mm256_zeroupper();
+    found = search_crlfcrlf_sse2(buff + i, len - i);
+    return (found == -1)? -1: (ssize_t)(i + found);
+}
+
+
+/* c <= 0x1f is tested as min(c, 0x1f) == c, the unsigned compare which
+ * sse2 lacks. the space is never a CTL, so it stands for the HTAB when the
+ * HTAB is not skipped. */
+__attribute__((target("sse2")))
+ssize_t
+search_ctl_sse2(const char *buff, size_t len, int tab) {
+    size_t i = 0;
+    unsigned int mask;
+    ssize_t found;
+    __m128i c;
+    const __m128i us = _mm_set1_epi8(0x1f);
+    const __m128i del = _mm_set1_epi8(0x7f);
+    const __m128i ht = _mm_set1_epi8(tab? '\t': ' ');
+
+    for (; (i + 16) <= len; i += 16) {
+        c = _mm_loadu_si128((const __m128i *)(buff + i));
+        mask = _mm_movemask_epi8(_mm_andnot_si128(
+                _mm_cmpeq_epi8(c, ht),
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(c, _mm_min_epu8(c, us)),
+                    _mm_cmpeq_epi8(c, del))));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    found = search_ctl_scalar(buff + i, len - i, tab);
+    return (found == -1)? -1: (ssize_t)(i + found);
+}
+
+
+__attribute__((target("avx2")))
+ssize_t
+search_ctl_avx2(const char *buff, size_t len, int tab) {
+    size_t i = 0;
+    unsigned int mask;
+    ssize_t found;
+    __m256i c;
+    const __m256i us = _mm256_set1_epi8(0x1f);
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    const __m256i ht = _mm256_set1_epi8(tab? '\t': ' ');
+
+    for (; (i + 32) <= len; i += 32) {
+        c = _mm256_loadu_si256((const __m256i *)(buff + i));
+        mask = _mm256_movemask_epi8(_mm256_andnot_si256(
+                _mm256_cmpeq_epi8(c, ht),
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8(c, _mm256_min_epu8(c, us)),
+                    _mm256_cmpeq_epi8(c, del))));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    /* the legacy sse2 tail stalls on the dirty upper halves */
+    _mm256_zeroupper();
+    found = search_ctl_sse2(buff + i, len - i, tab);
+    return (found == -1)? -1: (ssize_t)(i + found);
+}
+
+#endif
+
+
+static ssize_t
+_crlfcrlf_resolve(const char *buff, size_t len);
+static ssize_t
+_ctl_resolve(const char *buff, size_t len, int tab);
+static search_kernel_t _crlfcrlf = _crlfcrlf_resolve;
+static search_ctlkernel_t _ctl = _ctl_resolve;
+
+
+/* select the kernels at the first call. the worker threads may race to
+ * resolve them, it's idempotent, and the pointers are accessed atomically
+ * so none of them sees a torn one */
+static void
+_resolve() {
+    search_kernel_t crlfcrlf = search_crlfcrlf_scalar;
+    search_ctlkernel_t ctl = search_ctl_scalar;
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        crlfcrlf = search_crlfcrlf_avx2;
+        ctl = search_ctl_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        crlfcrlf = search_crlfcrlf_sse2;
+        ctl = search_ctl_sse2;
+    }
+#endif
+
+    __atomic_store_n(&_crlfcrlf, crlfcrlf, __ATOMIC_RELAXED);
+    __atomic_store_n(&_ctl, ctl, __ATOMIC_RELAXED);
+}
+
+
+static ssize_t
+_crlfcrlf_resolve(const char *buff, size_t len) {
+    _resolve();
+    return search_crlfcrlf(buff, len);
+}
+
+
+static ssize_t
+_ctl_resolve(const char *buff, size_t len, int tab) {
+    _resolve();
+    return search_ctl(buff, len, tab);
+}
+
+
+ssize_t
+search_crlfcrlf(const char *buff, size_t len) {
+    return __atomic_load_n(&_crlfcrlf, __ATOMIC_RELAXED)(buff, len);
+}
+
+
+ssize_t
+search_ctl(const char *buff, size_t len, int tab) {
+    return __atomic_load_n(&_ctl, __ATOMIC_RELAXED)(buff, len, tab);
+}
@@ -0,0 +1,68 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_SEARCH_H_
+#define CARROT_SEARCH_H_
+
+
+/* standard */
+#include <stddef.h>
+#include <sys/types.h>
+
+
+typedef ssize_t (*search_kernel_t)(const char *buff, size_t len);
+typedef ssize_t (*search_ctlkernel_t)(const char *buff, size_t len, int tab);
+
+
+/* the best available kernel, selected at runtime */
+ssize_t
+search_crlfcrlf(const char *buff, size_t len);
+
+
+ssize_t
+search_crlfcrlf_scalar(const char *buff, size_t len);
+
+
+/* the best available kernel, selected at runtime */
+ssize_t
+search_ctl(const char *buff, size_t len, int tab);
+
+
+ssize_t
+search_ctl_scalar(const char *buff, size_t len, int tab);
+
+
+#if defined(__x86_64__) || defined(__i386__)
+ssize_t
+search_crlfcrlf_sse2(const char *buff, size_t len);
+
+
+ssize_t
+search_crlfcrlf_avx2(const char *buff, size_t len);
+
+
+ssize_t
+search_ctl_sse2(const char *buff, size_t len, int tab);
+
+
+ssize_t
+search_ctl_avx2(const char *buff, size_t len, int tab);
+#endif
+
+
+#endif  // CARROT_SEARCH_H_
@@ -21,6 +21,19 @@
 #include <stdio.h>
 #include <errno.h>
 
+/* posix */
+#include <signal.h>
+#include <pthread.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
 /* thirdparty */
 #include <clog.h>
 #include <pcaio/pcaio.h>
@@ -37,14 +50,51 @@
 #include "socket.h"
 #include "router.h"
 #include "server.h"
+#include "worker.h"
+#include "master.h"
+#include "pool.h"
+#include "timer.h"
+#include "asset.h"
+#include "fdcache.h"
+#include "header.h"
+#include "method.h"
+#include "encoding.h"
+#include "compress.h"
+#include "offload.h"
 
 
 const struct carrot_server_config carrot_server_defaultconfig = {
     .bind = "127.0.0.1:8080",
-    .backlog = 10,
+    .backlog = SOMAXCONN,
+    .acceptbatch = 64,
+    .deferaccept = 0,
+    .fastopen = 0,
     .requestbuffer_mempages = 1,
     .connectionbuffer_mempages = 1,
-    .connections_max = 10,
+    .connectionbuffer_maxpages = 16,
+    .outputbuffer_mempages = 1,
+    .connections_max = 1024,
+    .connectionpool_size = 64,
+    .connectionpool_prefault = 0,
+    .bufferpool_size = 64,
+    .timeout_header = 10000,
+    .timeout_body = 30000,
+    .timeout_idle = 5000,
+    .timeout_write = 30000,
+    .header_maxsize = 8192,
+    .tmpdir = "/tmp",
+    .assetcache_size = 0,
+    .assetcache_filemax = 65536,
+    .fdcache_size = 0,
+    .fdcache_ttl = 1000,
+    .compression_level = 0,
+    .compression_minsize = 1024,
+    .compression_types = NULL,
+    .compression_poolsize = 16,
+    .offload_threads = 0,
+    .offload_queuemax = 1024,
+    .workers = 1,
+    .processes = 1,
 };
 
 
@@ -65,229 +115,1748 @@ carrot_server_new(const struct carrot_server_config *c) {
     }
 
     s->listenfd = -1;
-    s->router.count = 0;
+    s->router.root = NULL;
+    s->router.dispatcher = NULL;
+    s->router.dispatched = NULL;
     s->config = c;
+    s->wakefd = -1;
+    s->paused = 0;
+    s->acceptfd = -1;
+    s->stopfd = -1;
+    s->sigfd = -1;
+    s->connections = 0;
+    memset(&s->stats, 0, sizeof(s->stats));
+    s->live = NULL;
+    s->stopping = 0;
+    s->ticking = 0;
+    s->workers = NULL;
+    s->workerscount = 0;
+    s->pool.free = NULL;
+    s->pool.count = 0;
+    timerwheel_init(&s->wheel);
+    s->statics = NULL;
+    s->assets = NULL;
+    s->fds = NULL;
+    memset(&s->date, 0, sizeof(s->date));
+    memset(&s->compressors, 0, sizeof(s->compressors));
+    s->offload = NULL;
+    s->waitfds.count = 0;
     return s;
 }
 
 
+/** snapshot of the counters of this process, summed over it's workers.
+ * the worker processes count on their own, so all of them are zero in the
+ * master process if the config->processes is greater than one.
+ */
+void
+carrot_server_stats(struct carrot_server *s,
+        struct carrot_server_stats *out) {
+    unsigned int i;
+    struct carrot_server *w;
+
+    memset(out, 0, sizeof(struct carrot_server_stats));
+    if (s->workers == NULL) {
+        out->connections = s->connections;
+        out->accepted = s->stats.accepted;
+        out->closed = s->stats.closed;
+        out->capped = s->stats.capped;
+        out->timedout = s->stats.timedout;
+        out->buffers = s->pool.attached;
+        out->buffers_idle = s->pool.idle;
+    }
+
+    /* the counters are owned by the worker threads, this is a snapshot */
+    for (i = 0; s->workers && (i < s->workerscount); i++) {
+        w = &s->workers[i].server;
+        out->connections += __atomic_load_n(&w->connections,
+                __ATOMIC_RELAXED);
+        out->accepted += __atomic_load_n(&w->stats.accepted,
+                __ATOMIC_RELAXED);
+        out->closed += __atomic_load_n(&w->stats.closed, __ATOMIC_RELAXED);
+        out->capped += __atomic_load_n(&w->stats.capped, __ATOMIC_RELAXED);
+        out->timedout += __atomic_load_n(&w->stats.timedout,
+                __ATOMIC_RELAXED);
+        out->buffers += __atomic_load_n(&w->pool.attached, __ATOMIC_RELAXED);
+        out->buffers_idle += __atomic_load_n(&w->pool.idle,
+                __ATOMIC_RELAXED);
+    }
+
+    if (out->connections) {
+        out->buffers_perconnection = out->buffers / out->connections;
+    }
+
+    /* shared by the workers */
+    if (s->offload) {
+        pthread_mutex_lock(&s->offload->lock);
+        out->offload_queued = s->offload->queued;
+        out->offload_running = s->offload->running;
+        out->offload_completed = s->offload->completed;
+        out->offload_rejected = s->offload->rejected;
+        pthread_mutex_unlock(&s->offload->lock);
+    }
+}
+
+
 void
 carrot_server_free(struct carrot_server *s) {
+    struct static_dir *d;
+
     if (s == NULL) {
         return;
     }
+
+    while (s->statics) {
+        d = s->statics;
+        s->statics = d->next;
+        static_dir_free(d);
+    }
+    router_deinit(&s->router);
     free(s);
 }
 
 
+/** register the handler for the methods mask and the path, the GET
+ * handlers are serving the HEAD requests too, unless there is a dedicated
+ * HEAD handler for the path.
+ */
 int
-carrot_server_route(struct carrot_server *s, const char *verb, const char *path,
-        carrot_handler_t handler, void *ptr) {
-    return router_append(&s->router, verb, path, handler, ptr);
+carrot_server_route(struct carrot_server *s, unsigned int methods,
+        const char *path, carrot_handler_t handler, void *ptr) {
+    return carrot_server_routex(s, methods, path, handler, ptr, NULL);
 }
 
 
-ssize_t
-carrot_server_responseA(struct carrot_connection *c, int status,
-        const char *text, const char *content, size_t contentlen, int flags) {
-    struct chttp_packet p;
-    ssize_t ret;
+/** same as the carrot_server_route() but with options. the extra headers
+ * are rendered once here and sent with every carrot_server_responseA() of
+ * the route.
+ */
+int
+carrot_server_routex(struct carrot_server *s, unsigned int methods,
+        const char *path, carrot_handler_t handler, void *ptr,
+        const struct carrot_route_options *options) {
+    struct route *r;
+    char *headers = NULL;
+    size_t headerslen = 0;
 
-    if (text == NULL) {
-        text = chttp_status_text(status);
+    if (options && options->headers) {
+        headers = header_block(options->headers, &headerslen);
+        if (headers == NULL) {
+            return -1;
+        }
     }
 
-    if (contentlen == -1) {
-        contentlen = strlen(content);
+    r = router_append(&s->router, methods, path, handler, ptr);
+    if (r == NULL) {
+        free(headers);
+        return -1;
     }
 
-    ERR(chttp_packet_allocate(&p, 1, 1, CHTTP_TE_NONE));
-    ERR(chttp_packet_startresponse(&p, status, text));
-    ERR(chttp_packet_contenttype(&p, "text/plain", "utf-8"));
-    ERR(chttp_packet_write(&p, content, contentlen));
-    if (flags & CARROT_SRF_APPENDCRLF) {
-        ERR(chttp_packet_write(&p, "\r\n", 2));
+    r->headers = headers;
+    r->headerslen = headerslen;
+    if (options) {
+        r->bodymax = options->bodymax;
+        r->spillover = options->spillover;
+        r->header_maxsize = options->header_maxsize;
+        r->ringpages = options->ringpages;
+    }
+    return 0;
+}
+
+
+/** route the requests using the build-time compiled dispatcher, the
+ * requests which are not matched by the dispatcher are looked up in the
+ * routes registered by the carrot_server_route().
+ */
+int
+carrot_server_dispatcher(struct carrot_server *s,
+        const struct carrot_dispatcher *d) {
+    return router_dispatcher(&s->router, d);
+}
+
+
+/** returns the value of the path parameter captured by the :name or *name
+ * placeholder of the matched route, and it's length, or NULL if not found.
+ * the value is pointing to the request path and is not NULL terminated. the
+ * anonymous wildcard is named "*".
+ */
+const char *
+carrot_server_param(struct carrot_connection *c, const char *name,
+        size_t *len) {
+    int i;
+    struct router_params *params = &CONN(c)->params;
+
+    for (i = 0; i < params->count; i++) {
+        if (strcmp(params->list[i].name, name) == 0) {
+            if (len) {
+                *len = params->list[i].len;
+            }
+            return params->list[i].value;
+        }
     }
-    ERR(chttp_packet_close(&p));
-    ret = carrot_connection_sendpacketA(c, &p);
-    chttp_packet_free(&p);
 
-    return ret;
+    return NULL;
 }
 
 
-ssize_t
-carrot_server_rejectA(struct carrot_connection *c, int status,
-        const char *text) {
-    const char *content;
+#define MS2TICKS(ms) \
+    (((ms) + CONFIG_CARROT_TIMER_TICKMS - 1) / CONFIG_CARROT_TIMER_TICKMS)
 
-    content = chttp_status_text(status);
-    return carrot_server_responseA(c, status, text, content, -1,
-            CARROT_SRF_APPENDCRLF);
+
+static void
+_conn_timeout(struct timer *t) {
+    struct server_conn *conn = (struct server_conn *)
+        ((char *)t - offsetof(struct server_conn, timer));
+
+    /* wakeup the connection's pending read or write with an error */
+    conn->timedout = 1;
+    shutdown(conn->fd, SHUT_RDWR);
+}
+
+
+/* arm the connection timer, or cancel it if ms is zero */
+static void
+_conn_timer(struct server_conn *conn, unsigned int ms) {
+    if (ms == 0) {
+        timer_cancel(&conn->timer);
+        return;
+    }
+
+    timer_arm(&conn->server->wheel, &conn->timer, MS2TICKS(ms));
+}
+
+
+/** HTTP/1.0 closes the connection by default and HTTP/1.1 keeps it alive,
+ * unless the Connection header says something else.
+ */
+static void
+_conn_keepalive(struct server_conn *conn, const char *header, size_t len) {
+    const char *eol;
+    const char *connection;
+
+    eol = memmem(header, len, "\r\n", 2);
+    conn->http10 = eol && ((eol - header) >= 8) &&
+        (memcmp(eol - 8, "HTTP/1.0", 8) == 0);
+    conn->keepalive = !conn->http10;
+
+    connection = chttp_headerset_get(&conn->request->headers, "Connection");
+
+    /* a list of options, e.g. keep-alive, Upgrade */
+    if (connection && encoding_hastoken(connection, "close")) {
+        conn->keepalive = 0;
+    }
+    else if (connection && encoding_hastoken(connection, "keep-alive")) {
+        conn->keepalive = 1;
+    }
+
+    /* the last request of a stopping worker */
+    if (conn->server->stopping) {
+        conn->keepalive = 0;
+    }
 }
 
 
+/** serve the files inside the root directory under the path prefix, for GET
+ * and HEAD requests.
+ */
 int
-server_connA(struct carrot_server *s, int fd) {
-    int ret = 0;
-    struct carrot_connection c;
-    ssize_t headerlen;
-    chttp_status_t status;
-    struct route *route;
-    socklen_t addrlen = sizeof(union saddr);
-    char tmp[32];
+carrot_server_static(struct carrot_server *s, const char *path,
+        const char *root) {
+    struct static_dir *d;
 
-    /* render the peer address for logging purpose */
-    ERR(getpeername(fd, (struct sockaddr *)&c.peer, &addrlen));
-    if (saddr_tostr(tmp, sizeof(tmp), &c.peer)) {
-        close(fd);
+    d = static_dir_new(path, root);
+    if (d == NULL) {
         return -1;
     }
 
-    INFO("new connection: %s, fd: %d", tmp, fd);
-    if (mrb_init(&c.ring, s->config->connectionbuffer_mempages)) {
-        close(fd);
+    if (router_append(&s->router, CARROT_METHOD_GET, d->pattern,
+                static_handlerA, d) == NULL) {
+        static_dir_free(d);
         return -1;
     }
 
-    c.fd = fd;
-    c.request = chttp_request_new(s->config->requestbuffer_mempages);
-    if (c.request == NULL) {
-        mrb_deinit(&c.ring);
-        close(fd);
-        return -1;
+    d->next = s->statics;
+    s->statics = d;
+    return 0;
+}
+
+
+/* rendered Connection header, according to the keep-alive state */
+const char *
+server_connectionheader(struct carrot_connection *c) {
+    if (!CONN(c)->keepalive) {
+        return "Connection: close\r\n";
     }
 
-    /* connection main loop */
-    for (;;) {
-        /* read as much as possible from the socket */
-        /* FIXME: check if this is a head-only request */
-        headerlen = carrot_connection_recvsearchA(&c, "\r\n\r\n");
-        if (headerlen <= 0) {
-            /* connection error */
-            ret = -1;
-            break;
-        }
+    if (CONN(c)->http10) {
+        return "Connection: keep-alive\r\n";
+    }
 
-        headerlen += 2;
-        status = chttp_request_parse(c.request, mrb_readerptr(&c.ring),
-                headerlen);
-        if (status > 0) {
-            carrot_server_rejectA(&c, status, NULL);
-            ret = -1;
-            break;
-        }
+    return "";
+}
 
-        if (status < 0) {
-            ERROR("status: %d", status);
-            ret = -1;
-            break;
-        }
 
-        if (mrb_skip(&c.ring, headerlen + 2)) {
-            ERROR("mrb_skip");
-            ret = -1;
-            break;
-        }
+/* rendered Date header of the worker, refreshed once per second */
+const char *
+server_dateheader(struct carrot_connection *c) {
+    return header_date(&CONN(c)->server->date, NULL);
+}
 
-        route = router_find(&s->router, c.request->verb, c.request->path);
-        if (route == NULL) {
-            carrot_server_rejectA(&c, 404, NULL);
-            continue;
-        }
 
-        INFO("new request: %s %s %s, route: %p", c.request->verb,
-                c.request->path, c.request->query, route);
+#define RESPONSE_HEADERSIZE 1024
+#define TEXTPLAIN "text/plain; charset=utf-8"
 
-        if (route->handler(&c, route->ptr)) {
-            // TODO: log the unhandled server error
-            carrot_server_rejectA(&c, 500, NULL);
-            ret = -1;
-            break;
+
+/* response body framing of the carrot_server_streamA() */
+enum {
+    STREAM_NONE = 0,
+    STREAM_RAW,
+    STREAM_CHUNKED,
+    STREAM_HEADONLY,
+};
+
+
+/** render the response header into the buffer using the pre-rendered
+ * status line, Date header and the extra headers. contentlen -1: the
+ * content is streamed, chunked or until the connection is closed for the
+ * HTTP/1.0 clients. vary: the content coding depends on the
+ * Accept-Encoding, whether or not the content is compressed.
+ */
+static int
+_header(struct carrot_connection *c, char *header, int status,
+        const char *text, const char *contenttype, ssize_t contentlen,
+        const char *coding, int vary, const char *extra, size_t extralen) {
+    int len;
+    size_t linelen;
+    const char *line;
+
+    /* status line */
+    line = text? NULL: header_statusline(status, &linelen);
+    if (line) {
+        memcpy(header, line, linelen);
+        len = linelen;
+    }
+    else {
+        len = snprintf(header, RESPONSE_HEADERSIZE, "HTTP/1.1 %d %s\r\n",
+                status, text? text: chttp_status_text(status));
+        ASSRT((len > 0) && (len < RESPONSE_HEADERSIZE));
+    }
+
+    line = header_date(&CONN(c)->server->date, &linelen);
+    ASSRT((len + linelen) < RESPONSE_HEADERSIZE);
+    memcpy(header + len, line, linelen);
+    len += linelen;
+
+    if (extra) {
+        ASSRT((len + extralen) < RESPONSE_HEADERSIZE);
+        memcpy(header + len, extra, extralen);
+        len += extralen;
+    }
+
+    linelen = snprintf(header + len, RESPONSE_HEADERSIZE - len,
+            "Content-Type: %s\r\n", contenttype);
+    ASSRT((len + linelen) < RESPONSE_HEADERSIZE);
+    len += linelen;
+
+    if (coding) {
+        linelen = snprintf(header + len, RESPONSE_HEADERSIZE - len,
+                "Content-Encoding: %s\r\n", coding);
+        ASSRT((len + linelen) < RESPONSE_HEADERSIZE);
+        len += linelen;
+    }
+
+    if (vary) {
+        linelen = snprintf(header + len, RESPONSE_HEADERSIZE - len,
+                "Vary: Accept-Encoding\r\n");
+        ASSRT((len + linelen) < RESPONSE_HEADERSIZE);
+        len += linelen;
+    }
+
+    if (contentlen >= 0) {
+        linelen = snprintf(header + len, RESPONSE_HEADERSIZE - len,
+                "Content-Length: %zd\r\n", contentlen);
+    }
+    else if (!CONN(c)->http10) {
+        linelen = snprintf(header + len, RESPONSE_HEADERSIZE - len,
+                "Transfer-Encoding: chunked\r\n");
+    }
+    else {
+        linelen = 0;
+    }
+    ASSRT((len + linelen) < RESPONSE_HEADERSIZE);
+    len += linelen;
+
+    linelen = snprintf(header + len, RESPONSE_HEADERSIZE - len, "%s\r\n",
+            server_connectionheader(c));
+    ASSRT((len + linelen) < RESPONSE_HEADERSIZE);
+    return len + linelen;
+}
+
+
+/* true if the content type is worth compressing, according to the
+ * config->compression_types if given */
+static int
+_compressible(const struct carrot_server_config *cfg,
+        const char *contenttype) {
+    const char *const *type;
+    size_t len;
+
+    if (cfg->compression_types == NULL) {
+        return encoding_compressible(contenttype);
+    }
+
+    len = strcspn(contenttype, ";");
+    for (type = cfg->compression_types; *type; type++) {
+        if ((strlen(*type) == len) &&
+                (strncasecmp(*type, contenttype, len) == 0)) {
+            return 1;
         }
+    }
+
+    return 0;
+}
+
 
-        /* make everything fresh for the next request */
-        mrb_reset(&c.ring);
-        chttp_request_reset(c.request);
+/* a compressor of the coding accepted by the client if the response is
+ * worth compressing, contentlen -1: unknown. vary is set if the content
+ * type is compressible, so the caches keep the variants apart even when
+ * this one is not compressed. the HEAD requests are negotiated too, so
+ * their headers are the same as the GET's. */
+static struct compressor *
+_compressor(struct carrot_connection *c, const char *contenttype,
+        ssize_t contentlen, int *vary) {
+    struct carrot_server *s = CONN(c)->server;
+    const struct carrot_server_config *cfg = s->config;
+    enum compress_coding coding;
+
+    *vary = (cfg->compression_level != 0) && _compressible(cfg, contenttype);
+    if ((*vary == 0) || ((contentlen >= 0) &&
+             ((size_t)contentlen < cfg->compression_minsize))) {
+        return NULL;
     }
 
-    /* free */
-    close(fd);
-    mrb_deinit(&c.ring);
-    free(c.request);
-    return ret;
+    coding = compress_negotiate(chttp_headerset_get(&c->request->headers,
+                "Accept-Encoding"));
+    if (coding == COMPRESS_NONE) {
+        return NULL;
+    }
+
+    return compressor_get(&s->compressors, coding, cfg->compression_level);
 }
 
 
-int
-carrot_serverA(struct carrot_server *s) {
-    union saddr listenaddr;
-    int cfd;
-    char tmp[64];
+static void
+_compressor_put(struct server_conn *conn, struct compressor *z) {
+    struct carrot_server *s = conn->server;
 
-    s->listenfd = socket_bind(s->config->bind, &listenaddr);
-    if (s->listenfd == -1) {
-        return -1;
+    compressor_put(&s->compressors, z, s->config->compression_poolsize);
+}
+
+
+/** the write timeout replaces the handler's one while sending, and it's
+ * re-armed by every write making progress (the connection's onprogress),
+ * so only the stalled peers are timed out.
+ */
+void
+server_writetimer(struct carrot_connection *c) {
+    struct server_conn *conn = CONN(c);
+
+    if (timer_armed(&conn->timer)) {
+        _conn_timer(conn, conn->server->config->timeout_write);
     }
+}
 
-    /* listen */
-    if (listen(s->listenfd, s->config->backlog)) {
+
+static ssize_t
+_streamA(struct carrot_connection *c, int status, const char *text,
+        const char *contenttype, struct compressor *z, int vary,
+        const char *extra, size_t extralen) {
+    struct server_conn *conn = CONN(c);
+    int len;
+    char header[RESPONSE_HEADERSIZE];
+
+    len = _header(c, header, status, text, contenttype, -1,
+            z? compress_codingname(z->coding): NULL, vary, extra, extralen);
+    if (c->method == CARROT_METHOD_HEAD) {
+        conn->stream = STREAM_HEADONLY;
+    }
+    else if (conn->http10) {
+        /* the end of the content is the end of the connection */
+        conn->keepalive = 0;
+        conn->stream = STREAM_RAW;
+    }
+    else {
+        conn->stream = STREAM_CHUNKED;
+    }
+
+    conn->compressor = z;
+    server_writetimer(c);
+    return carrot_connection_writeA(c, header, len);
+}
+
+
+/* send a chunk of the streamed content, framed according to the stream */
+static ssize_t
+_chunkA(struct carrot_connection *c, const char *data, size_t len) {
+    int vcount = 0;
+    char size[20];
+    struct iovec v[3];
+
+    if (len == 0) {
+        return 0;
+    }
+
+    if (CONN(c)->stream == STREAM_CHUNKED) {
+        v[vcount].iov_base = size;
+        v[vcount].iov_len = sprintf(size, "%zx\r\n", len);
+        vcount++;
+    }
+
+    v[vcount].iov_base = (void *)data;
+    v[vcount].iov_len = len;
+    vcount++;
+
+    if (CONN(c)->stream == STREAM_CHUNKED) {
+        v[vcount].iov_base = "\r\n";
+        v[vcount].iov_len = 2;
+        vcount++;
+    }
+
+    if (carrot_connection_writevA(c, v, vcount) < 0) {
         return -1;
     }
 
-    ERR(saddr_tostr(tmp, sizeof(tmp), &listenaddr));
-    INFO("listening on: %s", tmp);
-    for (;;) {
-        cfd = accept4A(s->listenfd, NULL, NULL, SOCK_NONBLOCK);
-        if (cfd == -1) {
-            if (errno == ECONNABORTED) {
-                /* ignore and continue */
-                continue;
-            }
+    /* the stream may live longer than the write timeout */
+    server_writetimer(c);
+    return len;
+}
 
-            if ((errno == ENFILE) || (errno == EMFILE)) {
-                /* open files limit, retry */
-                WARN("open files linit reached");
-                continue;
-            }
 
+/* compress the input and send the output chunk by chunk, the output buffer
+ * is reused after each write because the unsent remainder is copied into
+ * the output ring */
+static int
+_deflateA(struct carrot_connection *c, struct compressor *z, const void *in,
+        size_t len, int flush) {
+    int ret;
+
+    compressor_input(z, in, len);
+    do {
+        ret = compressor_run(z, flush);
+        if (ret == -1) {
             return -1;
         }
 
-        pcaio_fschedule(server_connA, NULL, 2, s, cfd);
-    }
+        if (_chunkA(c, z->buff, z->len) < 0) {
+            return -1;
+        }
+        z->len = 0;
+    } while (ret);
 
-    // TODO: move it to pcaio task disposation callback
-    close(s->listenfd);
     return 0;
 }
 
 
-int
-carrot_server_main(struct carrot_server *s) {
-    int ret;
-    pcaio_task_t task;
-    struct pcaio_iomodule *modepoll;
+/* give back the compressor of an unfinished stream */
+static void
+_conn_streamabort(struct server_conn *conn) {
+    if (conn->compressor) {
+        _compressor_put(conn, conn->compressor);
+        conn->compressor = NULL;
+    }
+    conn->stream = STREAM_NONE;
+}
 
-    /* register modules and tasks */
-    if (pcaio_modepoll_use(16, &modepoll)) {
-        return -1;
+
+static ssize_t
+_streamwriteA(struct carrot_connection *c, const char *data, size_t len) {
+    struct server_conn *conn = CONN(c);
+
+    server_writetimer(c);
+    if (conn->stream == STREAM_HEADONLY) {
+        return len;
     }
 
-    if (pcaio_modio_use(modepoll)) {
-        return -1;
+    if (conn->compressor == NULL) {
+        return _chunkA(c, data, len);
     }
 
-    // TODO: task status
-    task = pcaio_task_new(carrot_serverA, NULL, 1, s);
-    if (task == NULL) {
+    /* sync flush, so the peer receives each write as soon as it's sent */
+    if (_deflateA(c, conn->compressor, data, len, Z_SYNC_FLUSH)) {
         return -1;
     }
 
-    /* run event loop */
-    // TODO: only reflect the pcaio function result, and return task status
-    //       instead
-    ret = pcaio(1, &task, 1);
+    return len;
+}
+
+
+static int
+_streamendA(struct carrot_connection *c) {
+    struct server_conn *conn = CONN(c);
+    struct compressor *z = conn->compressor;
+    int stream = conn->stream;
+    int ret = 0;
+
+    conn->stream = STREAM_NONE;
+    conn->compressor = NULL;
+    if (z) {
+        if (stream != STREAM_HEADONLY) {
+            ret = _deflateA(c, z, NULL, 0, Z_FINISH);
+        }
+        _compressor_put(conn, z);
+    }
+
+    if (ret || (stream != STREAM_CHUNKED)) {
+        return ret;
+    }
+
+    return (carrot_connection_writeA(c, "0\r\n\r\n", 5) < 0)? -1: 0;
+}
+
+
+/** render the response header into a stack buffer and send it along with
+ * the content using a single writev, so no heap allocation is made per
+ * response. the pipelined responses are coalesced in the connection's
+ * output ring. the content is not sent for the HEAD requests, but it's
+ * still compressed when negotiated, so the Content-Length matches the GET.
+ * the content is compressed into the pooled compressor's buffer, or
+ * streamed using the chunked encoding if it may not fit.
+ */
+static ssize_t
+_responseA(struct carrot_connection *c, int status, const char *text,
+        const char *content, size_t contentlen, int flags,
+        const char *extra, size_t extralen) {
+    int len;
+    int vcount = 2;
+    size_t crlflen = 0;
+    const char *coding = NULL;
+    int vary;
+    struct compressor *z;
+    char header[RESPONSE_HEADERSIZE];
+    struct iovec v[3];
+    ssize_t ret;
+
+    if (contentlen == -1) {
+        contentlen = strlen(content);
+    }
+
+    if (flags & CARROT_SRF_APPENDCRLF) {
+        crlflen = 2;
+        v[vcount].iov_base = "\r\n";
+        v[vcount].iov_len = crlflen;
+        vcount++;
+    }
+
+    z = _compressor(c, TEXTPLAIN, contentlen + crlflen, &vary);
+    if (z && !compressor_fits(z, contentlen + crlflen)) {
+        if (CONN(c)->http10) {
+            _compressor_put(CONN(c), z);
+            z = NULL;
+        }
+        else if ((_streamA(c, status, text, TEXTPLAIN, z, vary, extra,
+                        extralen) < 0) ||
+                (_streamwriteA(c, content, contentlen) < 0) ||
+                (crlflen && (_streamwriteA(c, "\r\n", crlflen) < 0)) ||
+                _streamendA(c)) {
+            /* give back the compressor, the stream is unusable */
+            _conn_streamabort(CONN(c));
+            return -1;
+        }
+        else {
+            return contentlen + crlflen;
+        }
+    }
+
+    if (z) {
+        compressor_input(z, content, contentlen);
+        if (compressor_run(z, Z_NO_FLUSH) == 0) {
+            compressor_input(z, "\r\n", crlflen);
+            if (compressor_run(z, Z_FINISH) == 0) {
+                coding = compress_codingname(z->coding);
+                content = z->buff;
+                contentlen = z->len;
+                vcount = 2;
+                crlflen = 0;
+            }
+        }
+    }
+
+    len = _header(c, header, status, text, TEXTPLAIN, contentlen + crlflen,
+            coding, vary, extra, extralen);
+    v[0].iov_base = header;
+    v[0].iov_len = len;
+    v[1].iov_base = (void *)content;
+    v[1].iov_len = contentlen;
+    if (c->method == CARROT_METHOD_HEAD) {
+        vcount = 1;
+    }
+
+    server_writetimer(c);
+    ret = carrot_connection_writevA(c, v, vcount);
+    if (z) {
+        _compressor_put(CONN(c), z);
+    }
+
+    return ret;
+}
+
+
+ssize_t
+carrot_server_responseA(struct carrot_connection *c, int status,
+        const char *text, const char *content, size_t contentlen, int flags) {
+    const struct route *route = CONN(c)->route;
+
+    if (route && route->headers) {
+        return _responseA(c, status, text, content, contentlen, flags,
+                route->headers, route->headerslen);
+    }
+
+    return _responseA(c, status, text, content, contentlen, flags, NULL, 0);
+}
+
+
+/** start a response of unknown length, the content is sent using the
+ * carrot_server_streamwriteA() and terminated by the
+ * carrot_server_streamendA(). the chunked encoding is used, except for the
+ * HTTP/1.0 clients which read until the connection is closed. the content
+ * is compressed on the fly when negotiated and the content type is
+ * compressible.
+ */
+ssize_t
+carrot_server_streamA(struct carrot_connection *c, int status,
+        const char *contenttype) {
+    const struct route *route = CONN(c)->route;
+    struct compressor *z;
+    int vary;
+
+    if (contenttype == NULL) {
+        contenttype = TEXTPLAIN;
+    }
+
+    z = _compressor(c, contenttype, -1, &vary);
+    if (route && route->headers) {
+        return _streamA(c, status, NULL, contenttype, z, vary,
+                route->headers, route->headerslen);
+    }
+
+    return _streamA(c, status, NULL, contenttype, z, vary, NULL, 0);
+}
+
+
+ssize_t
+carrot_server_streamwriteA(struct carrot_connection *c, const char *data,
+        size_t len) {
+    ASSRT(CONN(c)->stream != STREAM_NONE);
+    return _streamwriteA(c, data, len);
+}
+
+
+int
+carrot_server_streamendA(struct carrot_connection *c) {
+    ASSRT(CONN(c)->stream != STREAM_NONE);
+    return _streamendA(c);
+}
+
+
+ssize_t
+carrot_server_rejectA(struct carrot_connection *c, int status,
+        const char *text) {
+    const char *content;
+
+    content = chttp_status_text(status);
+    return carrot_server_responseA(c, status, text, content, -1,
+            CARROT_SRF_APPENDCRLF);
+}
+
+
+/* the open connections of the worker, the idle ones are closed when
+ * stopping */
+static void
+_conn_link(struct server_conn *conn) {
+    struct carrot_server *s = conn->server;
+
+    conn->next = s->live;
+    if (s->live) {
+        s->live->pprev = &conn->next;
+    }
+    conn->pprev = &s->live;
+    s->live = conn;
+}
+
+
+static void
+_conn_unlink(struct server_conn *conn) {
+    if (conn->next) {
+        conn->next->pprev = conn->pprev;
+    }
+    *conn->pprev = conn->next;
+    conn->next = NULL;
+    conn->pprev = NULL;
+}
+
+
+/* wait for the next request without holding the buffers, they are
+ * attached again as soon as the data arrives. gives up when the worker is
+ * stopping. */
+static int
+_conn_idleA(struct server_conn *conn) {
+    struct carrot_server *s = conn->server;
+    char byte;
+    ssize_t bytes;
+
+    connpool_detach(&s->pool, s->config, conn);
+    conn->idle = 1;
+    while (!s->stopping) {
+        bytes = recv(conn->fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (bytes > 0) {
+            conn->idle = 0;
+            return connpool_attach(&s->pool, s->config, conn);
+        }
+
+        if ((bytes == 0) || !RETRY(errno)) {
+            break;
+        }
+
+        if (pcaio_modio_await(conn->fd, IOIN)) {
+            break;
+        }
+        errno = 0;
+    }
+
+    conn->idle = 0;
+    return -1;
+}
+
+
+/* double the input ring, up to the connectionbuffer_maxpages, when the
+ * header does not fit */
+static int
+_conn_growheader(struct server_conn *conn) {
+    struct carrot_server *s = conn->server;
+    unsigned int max = s->config->connectionbuffer_maxpages;
+
+    if (conn->ringpages >= max) {
+        return -1;
+    }
+
+    return connpool_grow(&s->pool, conn, MIN(conn->ringpages * 2, max));
+}
+
+
+/* receive the large and the chunked bodies into a temporary file before
+ * calling the handler, when enabled by the route */
+static int
+_conn_spillA(struct server_conn *conn) {
+    struct carrot_connection *c = (struct carrot_connection *)conn;
+    size_t spillover = conn->route->spillover;
+
+    if ((spillover == 0) || (c->bodyremain == 0) || ((c->bodyremain > 0) &&
+                ((size_t)c->bodyremain <= spillover))) {
+        return 0;
+    }
+
+    return carrot_connection_recvfileA(c, conn->server->config->tmpdir) < 0;
+}
+
+
+/* discard the unread part of the request body */
+static int
+_conn_discardA(struct carrot_connection *c) {
+    size_t used;
+    size_t bytes;
+
+    while (c->bodyremain > 0) {
+        used = mrb_used(&c->ring);
+        if (used == 0) {
+            ERR(carrot_connection_recvallA(c, NULL) <= 0);
+            continue;
+        }
+
+        bytes = MIN(used, (size_t)c->bodyremain);
+        ERR(mrb_skip(&c->ring, bytes));
+        c->bodyremain -= bytes;
+    }
+
+    return 0;
+}
+
+
+/* true if the next pipelined request header is already received */
+static int
+_conn_pipelined(struct carrot_connection *c) {
+    size_t used = mrb_used(&c->ring);
+    size_t body = c->bodyremain;
+
+    if ((c->bodyremain < 0) || (used < (body + 4))) {
+        return 0;
+    }
+
+    return memmem(mrb_readerptr(&c->ring) + body, used - body, "\r\n\r\n",
+            4) != NULL;
+}
+
+
+int
+server_connA(struct carrot_server *s, int fd) {
+    int ret = 0;
+    unsigned int requests = 0;
+    struct server_conn *conn;
+    struct carrot_connection *c;
+    ssize_t headerlen;
+    chttp_status_t status;
+    struct route *route;
+    const char *allow;
+    socklen_t addrlen = sizeof(union saddr);
+    char tmp[32];
+
+    conn = connpool_get(&s->pool, s->config);
+    if (conn == NULL) {
+        close(fd);
+        return -1;
+    }
+    c = (struct carrot_connection *)conn;
+    c->fd = fd;
+    conn->server = s;
+    _conn_link(conn);
+    conn->timedout = 0;
+    conn->keepalive = 1;
+    conn->http10 = 0;
+    conn->route = NULL;
+    conn->params.count = 0;
+    conn->stream = STREAM_NONE;
+    conn->compressor = NULL;
+    conn->timer.callback = _conn_timeout;
+    c->onprogress = server_writetimer;
+
+    /* render the peer address for logging purpose */
+    if (getpeername(fd, (struct sockaddr *)&c->peer, &addrlen) ||
+            saddr_tostr(tmp, sizeof(tmp), &c->peer)) {
+        _conn_unlink(conn);
+        connpool_put(&s->pool, s->config, conn);
+        close(fd);
+        return -1;
+    }
+
+    INFO("new connection: %s, fd: %d", tmp, fd);
+
+    /* connection main loop */
+    for (;;) {
+        /* wait for the next request, idle keep-alive connections are
+         * limited by the idle timeout */
+        if ((conn->ringpages == 0) || (mrb_used(&c->ring) == 0)) {
+            _conn_timer(conn, requests? s->config->timeout_idle:
+                    s->config->timeout_header);
+            if (_conn_idleA(conn) ||
+                    (carrot_connection_recvallA(c, NULL) <= 0)) {
+                /* connection error or closed by peer */
+                ret = -1;
+                break;
+            }
+        }
+
+        /* read as much as possible from the socket */
+        /* FIXME: check if this is a head-only request */
+        _conn_timer(conn, s->config->timeout_header);
+        /* grow the input ring if the header does not fit */
+        do {
+            headerlen = carrot_connection_recvheaderA(c,
+                    s->config->header_maxsize);
+        } while ((headerlen == -2) && (mrb_available(&c->ring) == 0) &&
+                (_conn_growheader(conn) == 0));
+
+        if ((headerlen == -2) || (headerlen == -3)) {
+            conn->keepalive = 0;
+            carrot_server_rejectA(c, (headerlen == -2)? 431: 400, NULL);
+            ret = -1;
+            break;
+        }
+
+        if (headerlen <= 0) {
+            /* connection error */
+            ret = -1;
+            break;
+        }
+
+        headerlen += 2;
+        status = chttp_request_parse(c->request, mrb_readerptr(&c->ring),
+                headerlen);
+        if (status > 0) {
+            conn->keepalive = 0;
+            carrot_server_rejectA(c, status, NULL);
+            ret = -1;
+            break;
+        }
+
+        if (status < 0) {
+            ERROR("status: %d", status);
+            ret = -1;
+            break;
+        }
+
+        _conn_keepalive(conn, mrb_readerptr(&c->ring), headerlen);
+        if (mrb_skip(&c->ring, headerlen + 2)) {
+            ERROR("mrb_skip");
+            ret = -1;
+            break;
+        }
+
+        /* accumulate the responses while the next request is buffered */
+        if (c->request->transferencoding & CHTTP_TE_CHUNKED) {
+            c->bodyremain = -1;
+        }
+        else {
+            c->bodyremain = c->request->contentlength;
+        }
+        c->chunkremain = 0;
+        c->bodyreceived = 0;
+        c->corked = _conn_pipelined(c);
+
+        requests++;
+        _conn_timer(conn, s->config->timeout_body);
+        c->method = method_parse(c->request->verb);
+        route = router_find(&s->router, c->method, c->request->path,
+                &conn->params, &allow);
+        conn->route = route;
+        if ((route == NULL) && allow) {
+            _responseA(c, 405, NULL, chttp_status_text(405), -1,
+                    CARROT_SRF_APPENDCRLF, allow, strlen(allow));
+        }
+        else if (route == NULL) {
+            carrot_server_rejectA(c, 404, NULL);
+        }
+        else if (route->header_maxsize &&
+                (((size_t)headerlen + 2) > route->header_maxsize)) {
+            conn->keepalive = 0;
+            carrot_server_rejectA(c, 431, NULL);
+        }
+        else if (route->bodymax && (c->bodyremain > 0) &&
+                ((size_t)c->bodyremain > route->bodymax)) {
+            /* do not bother reading the body */
+            conn->keepalive = 0;
+            carrot_server_rejectA(c, 413, NULL);
+        }
+        else {
+            INFO("new request: %s %s %s, route: %p", c->request->verb,
+                    c->request->path, c->request->query, route);
+
+            c->bodymax = route->bodymax;
+            if (connpool_grow(&s->pool, conn, route->ringpages) ||
+                    _conn_spillA(conn) || route->handler(c, route->ptr)) {
+                // TODO: log the unhandled server error
+                conn->keepalive = 0;
+                if (conn->stream != STREAM_NONE) {
+                    /* the status line is already sent */
+                    _conn_streamabort(conn);
+                }
+                else {
+                    carrot_server_rejectA(c, (c->bodymax &&
+                                (c->bodyreceived > c->bodymax))? 413: 500,
+                            NULL);
+                }
+                ret = -1;
+                break;
+            }
+
+            /* terminate the stream if the handler did not */
+            if ((conn->stream != STREAM_NONE) && _streamendA(c)) {
+                ret = -1;
+                break;
+            }
+        }
+
+        /* the spilled body is not needed anymore */
+        if (c->bodyfd != -1) {
+            close(c->bodyfd);
+            c->bodyfd = -1;
+        }
+
+        /* unfinished chunked body, the next request cannot be found */
+        if (c->bodyremain < 0) {
+            conn->keepalive = 0;
+        }
+
+        if (!conn->keepalive || s->stopping) {
+            break;
+        }
+
+        if (_conn_discardA(c)) {
+            ret = -1;
+            break;
+        }
+
+        /* the rest of the ring is the next pipelined request, if any */
+        chttp_request_reset(c->request);
+        c->method = CARROT_METHOD_UNKNOWN;
+        if (!_conn_pipelined(c)) {
+            c->corked = 0;
+            if (carrot_connection_flushA(c) < 0) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    /* send the queued responses, if any */
+    if (conn->ringpages) {
+        carrot_connection_flushA(c);
+    }
+
+    if (conn->timedout) {
+        STAT_ADD(s->stats.timedout, 1);
+        DEBUG("connection timed out: %s, fd: %d", tmp, fd);
+    }
+
+    /* give the connection back to the pool, with the compressor of the
+     * unfinished stream, if any */
+    _conn_timer(conn, 0);
+    _conn_streamabort(conn);
+    close(fd);
+    _conn_unlink(conn);
+    connpool_put(&s->pool, s->config, conn);
+    return ret;
+}
+
+
+/** drive the connection timeouts, one tick per CONFIG_CARROT_TIMER_TICKMS
+ * milliseconds, and invalidate the changed cached assets. it leaves when the
+ * worker is stopping and all the connections are closed.
+ */
+static int
+_tickerA(struct carrot_server *s) {
+    int ret = -1;
+    int fd;
+    int set;
+    ssize_t bytes;
+    uint64_t ticks;
+    struct epoll_event e = {.events = EPOLLIN};
+    struct itimerspec spec = {
+        .it_interval = {
+            .tv_sec = CONFIG_CARROT_TIMER_TICKMS / 1000,
+            .tv_nsec = (CONFIG_CARROT_TIMER_TICKMS % 1000) * 1000000,
+        },
+    };
+
+    spec.it_value = spec.it_interval;
+    fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd == -1) {
+        goto done;
+    }
+
+    /* the timer and the file changes are awaited at once */
+    set = epoll_create1(EPOLL_CLOEXEC);
+    if (set == -1) {
+        close(fd);
+        goto done;
+    }
+
+    e.data.fd = fd;
+    if (timerfd_settime(fd, 0, &spec, NULL) ||
+            epoll_ctl(set, EPOLL_CTL_ADD, fd, &e)) {
+        goto failed;
+    }
+
+    if (s->assets) {
+        e.data.fd = s->assets->inotifyfd;
+        if (epoll_ctl(set, EPOLL_CTL_ADD, e.data.fd, &e)) {
+            goto failed;
+        }
+    }
+
+    while (!s->stopping || s->connections) {
+        if (pcaio_modio_await(set, IOIN)) {
+            goto failed;
+        }
+
+        bytes = read(fd, &ticks, sizeof(ticks));
+        if (bytes == sizeof(ticks)) {
+            timerwheel_advance(&s->wheel, ticks);
+        }
+        else if ((bytes == -1) && !RETRY(errno)) {
+            goto failed;
+        }
+        errno = 0;
+
+        if (s->assets && assetcache_notify(s->assets)) {
+            goto failed;
+        }
+    }
+    ret = 0;
+
+failed:
+    close(set);
+    close(fd);
+
+done:
+    /* wakeup the stopping acceptor */
+    s->ticking = 0;
+    eventfd_write(s->wakefd, 1);
+    return ret;
+}
+
+
+/* optional tcp listener options, failures are not fatal */
+static void
+_listen_tcpoptions(struct carrot_server *s) {
+    int val;
+
+    /* wakeup the acceptor only when the request data is arrived */
+    val = s->config->deferaccept;
+    if (val && setsockopt(s->listenfd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &val,
+                sizeof(val))) {
+        WARN("setsockopt(TCP_DEFER_ACCEPT)");
+    }
+
+    val = s->config->fastopen;
+    if (val && setsockopt(s->listenfd, IPPROTO_TCP, TCP_FASTOPEN, &val,
+                sizeof(val))) {
+        WARN("setsockopt(TCP_FASTOPEN)");
+    }
+
+    errno = 0;
+}
+
+
+int
+server_listen(struct carrot_server *s, union saddr *listenaddr) {
+    int flags = 0;
+
+    if ((s->config->workers > 1) || (s->config->processes > 1)) {
+        flags |= SOCKET_REUSEPORT;
+    }
+
+    s->listenfd = socket_bind(s->config->bind, flags, listenaddr);
+    if (s->listenfd == -1) {
+        return -1;
+    }
+
+    /* listen */
+    if (listen(s->listenfd, s->config->backlog)) {
+        close(s->listenfd);
+        s->listenfd = -1;
+        return -1;
+    }
+
+    if (listenaddr->ss_family != AF_UNIX) {
+        _listen_tcpoptions(s);
+    }
+
+    return 0;
+}
+
+
+/* the members of the accept set */
+#define ACCEPT_LISTEN 0x1
+#define ACCEPT_WAKE 0x2
+#define ACCEPT_STOP 0x4
+
+
+/* the listen socket is left out of the set while paused */
+static int
+_acceptset_listen(struct carrot_server *s, int enable) {
+    struct epoll_event e = {
+        .events = EPOLLIN,
+        .data.u32 = ACCEPT_LISTEN,
+    };
+
+    return epoll_ctl(s->acceptfd, enable? EPOLL_CTL_ADD: EPOLL_CTL_DEL,
+            s->listenfd, &e);
+}
+
+
+/* the acceptor awaits the listen socket, the wakefd and the stop requests
+ * at once, using an epoll set */
+static int
+_acceptset_new(struct carrot_server *s) {
+    struct epoll_event e = {.events = EPOLLIN};
+
+    s->acceptfd = epoll_create1(EPOLL_CLOEXEC);
+    if (s->acceptfd == -1) {
+        return -1;
+    }
+
+    e.data.u32 = ACCEPT_WAKE;
+    if (epoll_ctl(s->acceptfd, EPOLL_CTL_ADD, s->wakefd, &e)) {
+        goto failed;
+    }
+
+    /* none of them if the carrot_serverA() is used directly */
+    e.data.u32 = ACCEPT_STOP;
+    if ((s->stopfd != -1) &&
+            epoll_ctl(s->acceptfd, EPOLL_CTL_ADD, s->stopfd, &e)) {
+        goto failed;
+    }
+
+    if ((s->sigfd != -1) &&
+            epoll_ctl(s->acceptfd, EPOLL_CTL_ADD, s->sigfd, &e)) {
+        goto failed;
+    }
+
+    if (_acceptset_listen(s, 1)) {
+        goto failed;
+    }
+
+    return 0;
+
+failed:
+    close(s->acceptfd);
+    s->acceptfd = -1;
+    return -1;
+}
+
+
+/* check the accept set, and wait for it if block is set. the wakefd is
+ * consumed. returns 1 if the stop is requested, which is never consumed so
+ * all the workers see it, -1 on error. */
+static int
+_acceptset_waitA(struct carrot_server *s, int block) {
+    struct epoll_event events[4];
+    eventfd_t value;
+    int count;
+    int ready = 0;
+
+    for (;;) {
+        count = epoll_wait(s->acceptfd, events, 4, 0);
+        if (count == -1) {
+            return -1;
+        }
+
+        if (count || !block) {
+            break;
+        }
+
+        if (pcaio_modio_await(s->acceptfd, IOIN)) {
+            return -1;
+        }
+    }
+
+    while (count--) {
+        ready |= events[count].data.u32;
+    }
+
+    if (ready & ACCEPT_WAKE) {
+        eventfd_read(s->wakefd, &value);
+        errno = 0;
+    }
+
+    return (ready & ACCEPT_STOP)? 1: 0;
+}
+
+
+/* stop polling the listen socket until the wakefd is written, returns 1 if
+ * the stop is requested meanwhile */
+static int
+_pauseA(struct carrot_server *s) {
+    int ret;
+
+    if (_acceptset_listen(s, 0)) {
+        return -1;
+    }
+
+    s->paused = 1;
+    ret = _acceptset_waitA(s, 1);
+    s->paused = 0;
+    if (_acceptset_listen(s, 1)) {
+        return -1;
+    }
+
+    return ret;
+}
+
+
+/* pause time of the acceptor when the open files limit is reached */
+#define ACCEPT_BACKOFFMS 100
+
+
+static void
+_backoff_expired(struct timer *t) {
+    struct carrot_server *s = (struct carrot_server *)
+        ((char *)t - offsetof(struct carrot_server, backoff));
+
+    eventfd_write(s->wakefd, 1);
+}
+
+
+/* the open files limit is reached, stop accepting until a connection is
+ * closed or the backoff timer is expired. returns 1 if the stop is
+ * requested meanwhile. */
+static int
+_backoffA(struct carrot_server *s) {
+    int ret;
+
+    STAT_ADD(s->stats.capped, 1);
+    timer_arm(&s->wheel, &s->backoff, MS2TICKS(ACCEPT_BACKOFFMS));
+    ret = _pauseA(s);
+    timer_cancel(&s->backoff);
+
+    return ret;
+}
+
+
+/** wait until the number of connections drops below the connections_max.
+ * the connections left in the kernel backlog meanwhile. returns 1 if the
+ * stop is requested.
+ */
+static int
+_admissionA(struct carrot_server *s) {
+    int ret = 0;
+
+    if ((s->config->connections_max == 0) ||
+            (s->connections < s->config->connections_max)) {
+        return 0;
+    }
+
+    STAT_ADD(s->stats.capped, 1);
+    DEBUG("connections_max reached: %u, stop accepting", s->connections);
+    while ((ret == 0) && (s->connections >= s->config->connections_max)) {
+        ret = _pauseA(s);
+    }
+
+    return ret;
+}
+
+
+static int
+_connA(struct carrot_server *s, int fd) {
+    int ret;
+
+    ret = server_connA(s, fd);
+    STAT_SUB(s->connections, 1);
+    STAT_ADD(s->stats.closed, 1);
+
+    /* wakeup the acceptor */
+    if (s->paused || s->stopping) {
+        eventfd_write(s->wakefd, 1);
+    }
+
+    return ret;
+}
+
+
+/** accept all pending connections, up to acceptbatch at once, without a
+ * scheduler round-trip per connection. then wait for the next readiness
+ * event if the backlog is empty. returns 1 if the stop is requested, -1 on
+ * error.
+ */
+static int
+_drainA(struct carrot_server *s) {
+    unsigned int i;
+    int cfd;
+    unsigned int max = s->config->connections_max;
+    unsigned int batch = s->config->acceptbatch? s->config->acceptbatch: 1;
+
+    for (i = 0; i < batch; i++) {
+        if (max && (s->connections >= max)) {
+            return 0;
+        }
+
+        cfd = accept4(s->listenfd, NULL, NULL, SOCK_NONBLOCK);
+        if (cfd == -1) {
+            if (RETRY(errno)) {
+                /* backlog is empty */
+                errno = 0;
+                return _acceptset_waitA(s, 1);
+            }
+
+            if (errno == ECONNABORTED) {
+                /* ignore and continue */
+                continue;
+            }
+
+            if ((errno == ENFILE) || (errno == EMFILE)) {
+                /* give back the idle cached files and try again */
+                if (s->fds && fdcache_shrink(s->fds, batch - i)) {
+                    errno = 0;
+                    continue;
+                }
+
+                /* open files limit, retry later */
+                WARN("open files limit reached, backing off");
+                errno = 0;
+                return _backoffA(s);
+            }
+
+            return -1;
+        }
+
+        if (pcaio_fschedule(_connA, NULL, 2, s, cfd)) {
+            close(cfd);
+            continue;
+        }
+
+        STAT_ADD(s->connections, 1);
+        STAT_ADD(s->stats.accepted, 1);
+    }
+
+    /* batch is exhausted, let the connections run. the backlog may never
+     * get empty under load, so check for the stop here too */
+    errno = 0;
+    pcaio_relaxA(0);
+    return _acceptset_waitA(s, 0);
+}
+
+
+/* stop accepting, close the idle connections and let the others finish
+ * their current request. the per worker state is freed after they and the
+ * ticker are gone, returns -1 if they cannot be waited for. */
+static int
+_stopA(struct carrot_server *s) {
+    struct server_conn *conn;
+    eventfd_t value;
+
+    s->stopping = 1;
+    for (conn = s->live; conn; conn = conn->next) {
+        if (conn->idle) {
+            shutdown(conn->fd, SHUT_RDWR);
+        }
+    }
+
+    while (s->connections || s->ticking) {
+        if (pcaio_modio_await(s->wakefd, IOIN)) {
+            return -1;
+        }
+
+        eventfd_read(s->wakefd, &value);
+        errno = 0;
+    }
+
+    return 0;
+}
+
+
+int
+carrot_serverA(struct carrot_server *s) {
+    union saddr listenaddr;
+    char tmp[64];
+    int ownlisten = 0;
+    int ret = -1;
+
+    /* the listen socket may already bound and shared between workers, it's
+     * closed by the one who opened it */
+    if (s->listenfd == -1) {
+        ERR(server_listen(s, &listenaddr));
+        ownlisten = 1;
+        if (saddr_tostr(tmp, sizeof(tmp), &listenaddr) == 0) {
+            INFO("listening on: %s", tmp);
+        }
+    }
+
+    s->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (s->wakefd == -1) {
+        goto closelisten;
+    }
+
+    if (_acceptset_new(s)) {
+        goto closewake;
+    }
+
+    if (connpool_init(&s->pool, s->config)) {
+        close(s->acceptfd);
+        s->acceptfd = -1;
+        goto closewake;
+    }
+
+    timerwheel_init(&s->wheel);
+    s->backoff.pprev = NULL;
+    s->backoff.callback = _backoff_expired;
+    s->live = NULL;
+    s->stopping = 0;
+
+    /* per worker static asset cache */
+    if (s->config->assetcache_size) {
+        s->assets = assetcache_new(s->config->assetcache_size,
+                s->config->assetcache_filemax);
+        if (s->assets == NULL) {
+            goto failed;
+        }
+    }
+
+    /* per worker open files cache */
+    if (s->config->fdcache_size) {
+        s->fds = fdcache_new(s->config->fdcache_size, s->config->fdcache_ttl);
+        if (s->fds == NULL) {
+            goto failed;
+        }
+    }
+
+    s->ticking = 1;
+    if (pcaio_fschedule(_tickerA, NULL, 1, s)) {
+        s->ticking = 0;
+        goto failed;
+    }
+
+    do {
+        ret = _admissionA(s);
+        if (ret == 0) {
+            ret = _drainA(s);
+        }
+    } while (ret == 0);
+
+failed:
+    /* the connections and the ticker are using the state below */
+    if (_stopA(s)) {
+        ERROR("cannot wait for the connections, the worker state is leaked");
+        goto closelisten;
+    }
+
+    assetcache_free(s->assets);
+    s->assets = NULL;
+    fdcache_free(s->fds);
+    s->fds = NULL;
+    compresspool_deinit(&s->compressors);
+    offload_waitfds_deinit(&s->waitfds);
+    connpool_deinit(&s->pool);
+    close(s->acceptfd);
+    s->acceptfd = -1;
+
+closewake:
+    close(s->wakefd);
+    s->wakefd = -1;
+
+closelisten:
+    if (ownlisten) {
+        close(s->listenfd);
+        s->listenfd = -1;
+    }
+
+    /* stopped on request */
+    return (ret == 1)? 0: -1;
+}
+
+
+int
+server_loop(struct carrot_server *s) {
+    int status = -1;
+    pcaio_task_t task;
+    struct pcaio_iomodule *modepoll;
+
+    /* register modules and tasks */
+    if (pcaio_modepoll_use(16, &modepoll)) {
+        return -1;
+    }
+
+    if (pcaio_modio_use(modepoll)) {
+        return -1;
+    }
+
+    task = pcaio_task_new(carrot_serverA, &status, 1, s);
+    if (task == NULL) {
+        return -1;
+    }
+
+    /* run event loop */
+    if (pcaio(1, &task, 1)) {
+        return -1;
+    }
+
+    return status;
+}
+
+
+/** run the workers of the process until they are stopped by SIGINT or
+ * SIGTERM, or one of them fails. the signals are blocked and received by a
+ * signalfd, so the event loops are never interrupted.
+ */
+int
+server_run(struct carrot_server *s) {
+    int ret = -1;
+    sigset_t set;
+    sigset_t old;
+    struct signalfd_siginfo info;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    if (pthread_sigmask(SIG_BLOCK, &set, &old)) {
+        return -1;
+    }
+
+    s->sigfd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (s->sigfd == -1) {
+        goto restore;
+    }
+
+    /* written by the failed worker to stop the others */
+    s->stopfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (s->stopfd == -1) {
+        goto closesig;
+    }
+
+    /* started after fork, shared by the workers of the process */
+    if (s->config->offload_threads) {
+        s->offload = offload_new(s->config->offload_threads,
+                s->config->offload_queuemax);
+        if (s->offload == NULL) {
+            goto closestop;
+        }
+    }
+
+    if (s->config->workers <= 1) {
+        ret = server_loop(s);
+    }
+    else {
+        INFO("starting %u workers", s->config->workers);
+        ret = workers_main(s, s->config->workers);
+    }
+
+    offload_free(s->offload);
+    s->offload = NULL;
+
+closestop:
+    close(s->stopfd);
+    s->stopfd = -1;
+
+closesig:
+    /* the received signals would be delivered once unblocked */
+    while (read(s->sigfd, &info, sizeof(info)) == sizeof(info)) {
+    }
+    errno = 0;
+    close(s->sigfd);
+    s->sigfd = -1;
+
+restore:
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return ret;
+}
+
+
+int
+carrot_server_main(struct carrot_server *s) {
+    int ret;
+    union saddr listenaddr;
+    char tmp[64];
+
+    /* timed out and reset connections are reported by write errors */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* unix domain sockets cannot be bound more than once, so the workers
+     * are sharing one bound here. the others are bound by each worker
+     * using SO_REUSEPORT after the fork, and the kernel balances the
+     * connections between them. */
+    if ((strncmp(s->config->bind, "unix://", 7) == 0) &&
+            ((s->config->processes > 1) || (s->config->workers > 1))) {
+        ERR(server_listen(s, &listenaddr));
+        if (saddr_tostr(tmp, sizeof(tmp), &listenaddr) == 0) {
+            INFO("listening on: %s", tmp);
+        }
+    }
+    else if (s->config->processes > 1) {
+        /* fail early, instead of restarting the workers which cannot bind */
+        ERR(server_listen(s, &listenaddr));
+        close(s->listenfd);
+        s->listenfd = -1;
+    }
+
+    if (s->config->processes > 1) {
+        INFO("starting %u worker processes", s->config->processes);
+        ret = master_main(s, s->config->processes);
+    }
+    else {
+        ret = server_run(s);
+    }
+
+    if (s->listenfd != -1) {
+        close(s->listenfd);
+    }
     carrot_server_free(s);
 
     return ret;
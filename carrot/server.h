@@ -22,12 +22,70 @@
 
 /* local private */
 #include "router.h"
+#include "pool.h"
+#include "timer.h"
+#include "static.h"
+#include "header.h"
+#include "compress.h"
+#include "offload.h"
 
 
+struct worker;
+struct assetcache;
+struct fdcache;
 struct carrot_server {
     const struct carrot_server_config *config;
     int listenfd;
     struct router router;
+
+    /* admission control, the eventfd wakes up the paused acceptor */
+    int wakefd;
+    int paused;
+    unsigned int connections;
+    struct carrot_server_stats stats;
+
+    /* the acceptor awaits the listen socket, the wakefd and the stop
+     * requests at once using this epoll set. the stopfd, written by a failed
+     * worker, and the signalfd of SIGINT and SIGTERM are shared by the
+     * workers of the process. */
+    int acceptfd;
+    int stopfd;
+    int sigfd;
+
+    /* preallocated connections, and the open ones */
+    struct connpool pool;
+    struct server_conn *live;
+
+    /* the worker stops accepting, closes the idle connections and waits
+     * for the others and the ticker before freeing it's state */
+    int stopping;
+    int ticking;
+
+    /* connection timeouts, driven by a timerfd */
+    struct timerwheel wheel;
+
+    /* wakes up the acceptor paused by the open files limit */
+    struct timer backoff;
+
+    /* static directories and the in-memory cache of their small files */
+    struct static_dir *statics;
+    struct assetcache *assets;
+    struct fdcache *fds;
+
+    /* cached Date header */
+    struct header_date date;
+
+    /* idle response compressors */
+    struct compresspool compressors;
+
+    /* offload thread pool shared by the workers, and the idle eventfds of
+     * this worker used to wait for the jobs */
+    struct offload *offload;
+    struct offload_waitfds waitfds;
+
+    /* worker threads, if any */
+    struct worker *workers;
+    unsigned int workerscount;
 };
 
 
@@ -35,4 +93,28 @@ int
 server_connA(struct carrot_server *s, int fd);
 
 
+const char *
+server_connectionheader(struct carrot_connection *c);
+
+
+const char *
+server_dateheader(struct carrot_connection *c);
+
+
+void
+server_writetimer(struct carrot_connection *c);
+
+
+int
+server_listen(struct carrot_server *s, union saddr *listenaddr);
+
+
+int
+server_loop(struct carrot_server *s);
+
+
+int
+server_run(struct carrot_server *s);
+
+
 #endif  // CARROT_SERVER_H_
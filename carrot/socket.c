@@ -75,7 +75,8 @@ _unix_bind(const char *addr, union saddr *out) {
 
 
 static int
-_inet_bind(const char *addr, const char *service, union saddr *out) {
+_inet_bind(const char *addr, const char *service, int flags,
+        union saddr *out) {
     int fd = -1;
     int reuse = 1;
     int err;
@@ -109,13 +110,24 @@ _inet_bind(const char *addr, const char *service, union saddr *out) {
         }
 
         if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
-                (void *)&reuse, sizeof(reuse)) == 0) {
-            if (bind(fd, cur->ai_addr, cur->ai_addrlen) == 0) {
-                /* success */
-                break;
-            }
+                (void *)&reuse, sizeof(reuse))) {
+            goto failed;
         }
 
+        /* let the kernel balance the connections between all sockets bound
+         * to the same address (one per worker). */
+        if ((flags & SOCKET_REUSEPORT) && setsockopt(fd, SOL_SOCKET,
+                    SO_REUSEPORT, (void *)&reuse, sizeof(reuse))) {
+            goto failed;
+        }
+
+        if (bind(fd, cur->ai_addr, cur->ai_addrlen) == 0) {
+            /* success */
+            break;
+        }
+
+failed:
+
         close(fd);
         fd = -1;
     }
@@ -133,7 +145,7 @@ _inet_bind(const char *addr, const char *service, union saddr *out) {
 
 
 int
-socket_bind(const char *addr, union saddr *out) {
+socket_bind(const char *addr, int flags, union saddr *out) {
     int ret;
     char *tmp;
     char *service;
@@ -154,7 +166,7 @@ socket_bind(const char *addr, union saddr *out) {
         return -1;
     }
 
-    ret = _inet_bind(tmp, service, out);
+    ret = _inet_bind(tmp, service, flags, out);
     free(tmp);
     return ret;
 }
@@ -24,8 +24,13 @@
 #include "carrot/addr.h"
 
 
+enum {
+    SOCKET_REUSEPORT = 0x1,
+};
+
+
 int
-socket_bind(const char *addr, union saddr *out);
+socket_bind(const char *addr, int flags, union saddr *out);
 
 
 #endif  // CARROT_SOCKET_H_
@@ -0,0 +1,555 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/* posix */
+#include <fcntl.h>
+#include <unistd.h>
+#include <strings.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/openat2.h>)
+#include <linux/openat2.h>
+#endif
+
+/* thirdparty */
+#include <clog.h>
+#include <chttp/chttp.h>
+
+/* local public */
+#include "carrot/server.h"
+#include "carrot/connection.h"
+
+/* local private */
+#include "common.h"
+#include "server.h"
+#include "pool.h"
+#include "static.h"
+#include "asset.h"
+#include "fdcache.h"
+#include "header.h"
+
+
+#define HEADERSIZE 1024
+
+
+struct range {
+    off_t start;
+    off_t end;
+};
+
+
+static const struct {
+    const char *extension;
+    const char *type;
+} _contenttypes[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "text/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+    {"mp4", "video/mp4"},
+    {NULL, NULL},
+};
+
+
+const char *
+static_contenttype(const char *path) {
+    int i;
+    const char *dot = strrchr(path, '.');
+
+    if ((dot == NULL) || strchr(dot, '/')) {
+        return "application/octet-stream";
+    }
+
+    dot++;
+    for (i = 0; _contenttypes[i].extension; i++) {
+        if (strcasecmp(dot, _contenttypes[i].extension) == 0) {
+            return _contenttypes[i].type;
+        }
+    }
+
+    return "application/octet-stream";
+}
+
+
+struct static_dir *
+static_dir_new(const char *prefix, const char *root) {
+    struct static_dir *d;
+    size_t prefixlen = strlen(prefix);
+
+    /* remove the trailing slash */
+    if (prefixlen && (prefix[prefixlen - 1] == '/')) {
+        prefixlen--;
+    }
+
+    d = malloc(sizeof(struct static_dir) + prefixlen + 3);
+    if (d == NULL) {
+        return NULL;
+    }
+
+    d->rootfd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (d->rootfd == -1) {
+        ERROR("cannot open the static directory: %s", root);
+        free(d);
+        return NULL;
+    }
+
+    d->root = strdup(root);
+    if (d->root == NULL) {
+        close(d->rootfd);
+        free(d);
+        return NULL;
+    }
+
+    d->next = NULL;
+    d->prefixlen = prefixlen;
+    memcpy(d->pattern, prefix, prefixlen);
+    strcpy(d->pattern + prefixlen, "/*");
+    return d;
+}
+
+
+void
+static_dir_free(struct static_dir *d) {
+    if (d == NULL) {
+        return;
+    }
+
+    close(d->rootfd);
+    free(d->root);
+    free(d);
+}
+
+
+/** returns the path relative to the root directory, or NULL if the path
+ * is escaping the root using .. segments.
+ */
+static const char *
+_relpath(const char *path) {
+    const char *seg;
+
+    while (path[0] == '/') {
+        path++;
+    }
+
+    for (seg = path; seg; seg = strchr(seg, '/')) {
+        if (seg[0] == '/') {
+            seg++;
+        }
+
+        if ((seg[0] == '.') && (seg[1] == '.') &&
+                ((seg[2] == '/') || (seg[2] == 0))) {
+            return NULL;
+        }
+    }
+
+    if (path[0] == 0) {
+        return "index.html";
+    }
+
+    return path;
+}
+
+
+/* open the path component by component without following any symlink */
+static int
+_open_nofollow(int rootfd, const char *path) {
+    int dirfd = rootfd;
+    int fd = -1;
+    const char *seg = path;
+    const char *slash;
+    char name[NAME_MAX + 1];
+    size_t len;
+
+    while ((slash = strchr(seg, '/'))) {
+        len = slash - seg;
+        if (len > NAME_MAX) {
+            errno = ENAMETOOLONG;
+            goto done;
+        }
+
+        memcpy(name, seg, len);
+        name[len] = 0;
+        seg = slash + 1;
+        if (len == 0) {
+            continue;
+        }
+
+        fd = openat(dirfd, name,
+                O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (dirfd != rootfd) {
+            close(dirfd);
+        }
+
+        dirfd = fd;
+        if (dirfd == -1) {
+            return -1;
+        }
+    }
+
+    fd = openat(dirfd, seg, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+
+done:
+    if (dirfd != rootfd) {
+        close(dirfd);
+    }
+    return fd;
+}
+
+
+/** open the file relative to the root of the static directory, the
+ * symlinks may not escape the root. openat2 with RESOLVE_BENEATH is used if
+ * available, otherwise no symlink is followed at all.
+ */
+int
+static_open(const struct static_dir *d, const char *path) {
+#if defined(SYS_openat2) && defined(RESOLVE_BENEATH)
+    int fd;
+    struct open_how how = {
+        .flags = O_RDONLY | O_CLOEXEC,
+        .resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS,
+    };
+
+    fd = syscall(SYS_openat2, d->rootfd, path, &how, sizeof(how));
+    if ((fd != -1) || (errno != ENOSYS)) {
+        return fd;
+    }
+    errno = 0;
+#endif
+
+    return _open_nofollow(d->rootfd, path);
+}
+
+
+static int
+_range_parse(const char *s, off_t size, struct range *r) {
+    char *end;
+    long long first;
+    long long last;
+
+    while (s[0] == ' ') {
+        s++;
+    }
+
+    if (s[0] == '-') {
+        /* suffix */
+        last = strtoll(s + 1, &end, 10);
+        ASSRT((end != (s + 1)) && (last >= 0));
+        r->start = (last < size)? (size - last): 0;
+        r->end = size - 1;
+        return (last == 0)? 1: 0;
+    }
+
+    first = strtoll(s, &end, 10);
+    ASSRT((end != s) && (end[0] == '-') && (first >= 0));
+    s = end + 1;
+    if ((s[0] == 0) || (s[0] == ',') || (s[0] == ' ')) {
+        last = size - 1;
+    }
+    else {
+        last = strtoll(s, &end, 10);
+        ASSRT((end != s) && (last >= first));
+    }
+
+    r->start = first;
+    r->end = MIN(last, size - 1);
+    return (first >= size)? 1: 0;
+}
+
+
+/** parse the Range header. returns the number of satisfiable ranges, 0 if
+ * the header is invalid and must be ignored and -1 if none of the ranges
+ * are satisfiable.
+ */
+static int
+_ranges_parse(const char *header, off_t size, struct range *ranges) {
+    int count = 0;
+    int unsatisfiable = 0;
+    int status;
+    const char *s;
+
+    if ((size == 0) || strncmp(header, "bytes=", 6)) {
+        return 0;
+    }
+
+    for (s = header + 6; s; s = strchr(s, ',')) {
+        if (s[0] == ',') {
+            s++;
+        }
+
+        if (count == STATIC_RANGES_MAX) {
+            break;
+        }
+
+        status = _range_parse(s, size, ranges + count);
+        if (status == -1) {
+            return 0;
+        }
+
+        if (status) {
+            unsatisfiable++;
+            continue;
+        }
+
+        count++;
+    }
+
+    if (count == 0) {
+        return unsatisfiable? -1: 0;
+    }
+
+    return count;
+}
+
+
+static int
+_headerA(struct carrot_connection *c, const char *buff, int len) {
+    ASSRT((len > 0) && (len < HEADERSIZE));
+    ERR(carrot_connection_writeA(c, buff, len) == -1);
+    return 0;
+}
+
+
+static int
+_multipartA(struct carrot_connection *c, int fd, struct stat *st,
+        const char *type, const char *lastmodified, struct range *ranges,
+        int count, int head) {
+    int i;
+    int len;
+    char boundary[32];
+    char buff[HEADERSIZE];
+    size_t contentlength = 0;
+
+    snprintf(boundary, sizeof(boundary), "carrot%08lx%08lx",
+            (unsigned long)st->st_ino, (unsigned long)st->st_mtime);
+
+    /* calculate the content length */
+    for (i = 0; i < count; i++) {
+        contentlength += snprintf(NULL, 0, "\r\n--%s\r\n"
+                "Content-Type: %s\r\n"
+                "Content-Range: bytes %lld-%lld/%lld\r\n\r\n", boundary, type,
+                (long long)ranges[i].start, (long long)ranges[i].end,
+                (long long)st->st_size);
+        contentlength += ranges[i].end - ranges[i].start + 1;
+    }
+    contentlength += snprintf(NULL, 0, "\r\n--%s--\r\n", boundary);
+
+    len = snprintf(buff, sizeof(buff), "%s%s%s"
+            "Content-Type: multipart/byteranges; boundary=%s\r\n"
+            "Content-Length: %zu\r\n"
+            "Last-Modified: %s\r\n"
+            "Accept-Ranges: bytes\r\n\r\n",
+            header_statusline(206, NULL), server_dateheader(c),
+            server_connectionheader(c), boundary, contentlength,
+            lastmodified);
+    ERR(_headerA(c, buff, len));
+    if (head) {
+        return 0;
+    }
+
+    for (i = 0; i < count; i++) {
+        len = snprintf(buff, sizeof(buff), "\r\n--%s\r\n"
+                "Content-Type: %s\r\n"
+                "Content-Range: bytes %lld-%lld/%lld\r\n\r\n", boundary, type,
+                (long long)ranges[i].start, (long long)ranges[i].end,
+                (long long)st->st_size);
+        ERR(_headerA(c, buff, len));
+        ERR(carrot_connection_sendfileA(c, fd, ranges[i].start,
+                    ranges[i].end - ranges[i].start + 1) == -1);
+    }
+
+    len = snprintf(buff, sizeof(buff), "\r\n--%s--\r\n", boundary);
+    return _headerA(c, buff, len);
+}
+
+
+static int
+_serveA(struct carrot_connection *c, int fd, struct stat *st,
+        const char *type) {
+    struct chttp_request *req = c->request;
+    int head = c->method == CARROT_METHOD_HEAD;
+    int count = 0;
+    int len;
+    const char *header;
+    struct tm tm;
+    char lastmodified[32];
+    char buff[HEADERSIZE];
+    struct range ranges[STATIC_RANGES_MAX];
+
+    gmtime_r(&st->st_mtime, &tm);
+    strftime(lastmodified, sizeof(lastmodified), STATIC_HTTPDATE, &tm);
+
+    /* not modified */
+    header = chttp_headerset_get(&req->headers, "If-Modified-Since");
+    if (header && (strcmp(header, lastmodified) == 0)) {
+        len = snprintf(buff, sizeof(buff), "%s%s%s"
+                "Last-Modified: %s\r\n\r\n",
+                header_statusline(304, NULL), server_dateheader(c),
+                server_connectionheader(c), lastmodified);
+        return _headerA(c, buff, len);
+    }
+
+    header = chttp_headerset_get(&req->headers, "Range");
+    if (header) {
+        count = _ranges_parse(header, st->st_size, ranges);
+    }
+
+    if (count == -1) {
+        len = snprintf(buff, sizeof(buff), "%s%s%s"
+                "Content-Range: bytes */%lld\r\n"
+                "Content-Length: 0\r\n\r\n",
+                header_statusline(416, NULL), server_dateheader(c),
+                server_connectionheader(c), (long long)st->st_size);
+        return _headerA(c, buff, len);
+    }
+
+    if (count > 1) {
+        return _multipartA(c, fd, st, type, lastmodified, ranges, count,
+                head);
+    }
+
+    if (count == 0) {
+        ranges[0].start = 0;
+        ranges[0].end = st->st_size - 1;
+        len = snprintf(buff, sizeof(buff), "%s%s",
+                header_statusline(200, NULL), server_dateheader(c));
+    }
+    else {
+        len = snprintf(buff, sizeof(buff), "%s%s"
+                "Content-Range: bytes %lld-%lld/%lld\r\n",
+                header_statusline(206, NULL), server_dateheader(c),
+                (long long)ranges[0].start, (long long)ranges[0].end,
+                (long long)st->st_size);
+    }
+
+    ASSRT(len < sizeof(buff));
+    len += snprintf(buff + len, sizeof(buff) - len, "%s"
+            "Content-Type: %s\r\n"
+            "Content-Length: %lld\r\n"
+            "Last-Modified: %s\r\n"
+            "Accept-Ranges: bytes\r\n\r\n",
+            server_connectionheader(c), type,
+            (long long)(ranges[0].end - ranges[0].start + 1), lastmodified);
+    ERR(_headerA(c, buff, len));
+
+    if (head || (st->st_size == 0)) {
+        return 0;
+    }
+
+    ERR(carrot_connection_sendfileA(c, fd, ranges[0].start,
+                ranges[0].end - ranges[0].start + 1) == -1);
+    return 0;
+}
+
+
+/** serve the files inside the static directory using sendfile.
+ */
+int
+static_handlerA(struct carrot_connection *c, void *ptr) {
+    int ret;
+    int fd;
+    struct stat st;
+    struct static_dir *d = ptr;
+    struct carrot_server *s = CONN(c)->server;
+    const char *path;
+    struct asset *asset = NULL;
+    struct fdentry *e = NULL;
+    int ranged;
+
+    path = _relpath(c->request->path + d->prefixlen);
+    if (path == NULL) {
+        return carrot_server_rejectA(c, 403, NULL) == -1? -1: 0;
+    }
+
+    /* large files may take longer than the handler's timeout, the transfer
+     * is limited by the write timeout instead, re-armed on progress */
+    server_writetimer(c);
+
+    /* the whole-file responses of the small files are served from memory */
+    ranged = chttp_headerset_get(&c->request->headers, "Range") != NULL;
+    if (s->assets && (!ranged)) {
+        asset = assetcache_get(s->assets, d, path);
+        if (asset) {
+            return asset_serveA(c, asset);
+        }
+    }
+
+    if (s->fds) {
+        e = fdcache_open(s->fds, d, path);
+        if (e == NULL) {
+            errno = 0;
+            return carrot_server_rejectA(c, 404, NULL) == -1? -1: 0;
+        }
+        fd = e->fd;
+        st = e->st;
+    }
+    else {
+        fd = static_open(d, path);
+        if (fd == -1) {
+            errno = 0;
+            return carrot_server_rejectA(c, 404, NULL) == -1? -1: 0;
+        }
+
+        if (fstat(fd, &st) || (!S_ISREG(st.st_mode))) {
+            close(fd);
+            errno = 0;
+            return carrot_server_rejectA(c, 404, NULL) == -1? -1: 0;
+        }
+    }
+
+    if (s->assets && (!ranged)) {
+        asset = assetcache_load(s->assets, d, path, fd, &st);
+    }
+
+    if (asset) {
+        ret = asset_serveA(c, asset);
+    }
+    else {
+        ret = _serveA(c, fd, &st, e? e->type: static_contenttype(path));
+    }
+
+    if (e) {
+        fdcache_release(s->fds, e);
+    }
+    else {
+        close(fd);
+    }
+
+    return ret;
+}
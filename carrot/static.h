@@ -0,0 +1,63 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_STATIC_H_
+#define CARROT_STATIC_H_
+
+
+/* local public */
+#include "carrot/connection.h"
+
+
+/* maximum number of ranges per request, the rest will be ignored */
+#define STATIC_RANGES_MAX 8
+#define STATIC_HTTPDATE "%a, %d %b %Y %H:%M:%S GMT"
+
+
+struct static_dir {
+    struct static_dir *next;
+    int rootfd;
+    char *root;
+    size_t prefixlen;
+
+    /* route path: prefix/\* */
+    char pattern[];
+};
+
+
+struct static_dir *
+static_dir_new(const char *prefix, const char *root);
+
+
+void
+static_dir_free(struct static_dir *d);
+
+
+int
+static_handlerA(struct carrot_connection *c, void *ptr);
+
+
+int
+static_open(const struct static_dir *d, const char *path);
+
+
+const char *
+static_contenttype(const char *path);
+
+
+#endif  // CARROT_STATIC_H_
@@ -0,0 +1,143 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <string.h>
+
+/* local private */
+#include "common.h"
+#include "timer.h"
+
+
+#define LEVELSPAN(l) (1UL << (TIMER_SLOTBITS * (l)))
+#define LEVELINDEX(n, l) (((n) >> (TIMER_SLOTBITS * (l))) & TIMER_SLOTMASK)
+
+
+static void
+_add(struct timerwheel *w, struct timer *t) {
+    int level;
+    unsigned long delta;
+    struct timer **head;
+
+    /* clamp too far timers to the wheel capacity */
+    delta = t->expire - w->now;
+    if (delta >= LEVELSPAN(TIMER_LEVELS)) {
+        delta = LEVELSPAN(TIMER_LEVELS) - 1;
+        t->expire = w->now + delta;
+    }
+
+    for (level = 0; level < (TIMER_LEVELS - 1); level++) {
+        if (delta < LEVELSPAN(level + 1)) {
+            break;
+        }
+    }
+
+    head = &w->slots[level][LEVELINDEX(t->expire, level)];
+    t->next = *head;
+    if (t->next) {
+        t->next->pprev = &t->next;
+    }
+    t->pprev = head;
+    *head = t;
+}
+
+
+static void
+_cascade(struct timerwheel *w, int level, int index) {
+    struct timer *t;
+
+    while ((t = w->slots[level][index])) {
+        timer_cancel(t);
+        _add(w, t);
+    }
+}
+
+
+static void
+_tick(struct timerwheel *w) {
+    int level;
+    int index;
+    struct timer *t;
+
+    w->now++;
+
+    /* move the timers from upper levels when the lower one wraps */
+    for (level = 1; level < TIMER_LEVELS; level++) {
+        if (LEVELINDEX(w->now, level - 1)) {
+            break;
+        }
+
+        _cascade(w, level, LEVELINDEX(w->now, level));
+    }
+
+    /* fire, callbacks are allowed to arm or cancel any timer */
+    index = LEVELINDEX(w->now, 0);
+    while ((t = w->slots[0][index])) {
+        timer_cancel(t);
+        if (t->expire > w->now) {
+            /* clamped timer */
+            _add(w, t);
+            continue;
+        }
+
+        t->callback(t);
+    }
+}
+
+
+void
+timerwheel_init(struct timerwheel *w) {
+    memset(w, 0, sizeof(struct timerwheel));
+}
+
+
+void
+timerwheel_advance(struct timerwheel *w, unsigned long ticks) {
+    while (ticks--) {
+        _tick(w);
+    }
+}
+
+
+/** (re)arm the timer to be fired after the given ticks.
+ */
+void
+timer_arm(struct timerwheel *w, struct timer *t, unsigned long ticks) {
+    if (timer_armed(t)) {
+        timer_cancel(t);
+    }
+
+    t->expire = w->now + (ticks? ticks: 1);
+    _add(w, t);
+}
+
+
+void
+timer_cancel(struct timer *t) {
+    if (!timer_armed(t)) {
+        return;
+    }
+
+    *t->pprev = t->next;
+    if (t->next) {
+        t->next->pprev = t->pprev;
+    }
+
+    t->next = NULL;
+    t->pprev = NULL;
+}
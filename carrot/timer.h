@@ -0,0 +1,67 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+#ifndef CARROT_TIMER_H_
+#define CARROT_TIMER_H_
+
+
+/* hierarchical timing wheel, O(1) arm and cancel */
+#define TIMER_LEVELS 4
+#define TIMER_SLOTBITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOTBITS)
+#define TIMER_SLOTMASK (TIMER_SLOTS - 1)
+
+
+struct timer;
+typedef void (*timer_callback_t)(struct timer *t);
+
+
+struct timer {
+    struct timer *next;
+    struct timer **pprev;
+    unsigned long expire;
+    timer_callback_t callback;
+};
+
+
+struct timerwheel {
+    unsigned long now;
+    struct timer *slots[TIMER_LEVELS][TIMER_SLOTS];
+};
+
+
+void
+timerwheel_init(struct timerwheel *w);
+
+
+void
+timerwheel_advance(struct timerwheel *w, unsigned long ticks);
+
+
+void
+timer_arm(struct timerwheel *w, struct timer *t, unsigned long ticks);
+
+
+void
+timer_cancel(struct timer *t);
+
+
+#define timer_armed(t) ((t)->pprev != NULL)
+
+
+#endif  // CARROT_TIMER_H_
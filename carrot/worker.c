@@ -0,0 +1,102 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* posix */
+#include <sys/eventfd.h>
+
+/* thirdparty */
+#include <clog.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* local private */
+#include "common.h"
+#include "server.h"
+#include "worker.h"
+
+
+static void *
+_worker(void *arg) {
+    struct worker *w = arg;
+
+    INFO("worker #%u started", w->index);
+    w->status = server_loop(&w->server);
+    if (w->status) {
+        /* stop the others */
+        ERROR("worker #%u failed, status: %d", w->index, w->status);
+        eventfd_write(w->server.stopfd, 1);
+    }
+
+    return NULL;
+}
+
+
+/** run count event loops, each one in it's own thread with it's own listen
+ * socket, connections and caches. the server is copied shallowly, so the
+ * router, the static directories and the dispatcher are shared read-only by
+ * all the threads. the workers stop together on SIGINT, SIGTERM or when any
+ * of them fails. returns -1 if any of the workers are failed.
+ */
+int
+workers_main(struct carrot_server *s, unsigned int count) {
+    int ret = 0;
+    unsigned int i;
+    unsigned int started;
+    struct worker *workers;
+    struct worker *w;
+
+    workers = calloc(count, sizeof(struct worker));
+    if (workers == NULL) {
+        return -1;
+    }
+
+    for (started = 0; started < count; started++) {
+        w = workers + started;
+        w->index = started;
+        memcpy(&w->server, s, sizeof(struct carrot_server));
+        if (pthread_create(&w->thread, NULL, _worker, w)) {
+            ERROR("cannot start worker #%u", started);
+            eventfd_write(s->stopfd, 1);
+            ret = -1;
+            break;
+        }
+    }
+
+    /* expose workers for stats */
+    s->workers = workers;
+    s->workerscount = started;
+
+    /* wait for all workers to finish */
+    for (i = 0; i < started; i++) {
+        w = workers + i;
+        if (pthread_join(w->thread, NULL) || w->status) {
+            ret = -1;
+        }
+    }
+
+    s->workers = NULL;
+    s->workerscount = 0;
+    free(workers);
+    return ret;
+}
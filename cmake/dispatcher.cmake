@@ -0,0 +1,21 @@
+# Build-time compiled route dispatcher
+#
+# carrot_dispatcher(<name> <spec> <output>)
+#
+# generates the <output> C file from the <spec> file which contains one
+# CARROT_ROUTE(<verb>, "<path>", <handler>) per line, and defines the
+# `const struct carrot_dispatcher <name>` to be passed to the
+# carrot_server_dispatcher(). lines starting with # or // are ignored.
+function(carrot_dispatcher name spec output)
+  get_filename_component(spec ${spec} ABSOLUTE)
+  add_custom_command(
+    OUTPUT ${output}
+    COMMAND ${CMAKE_COMMAND}
+      -DNAME=${name}
+      -DSPEC=${spec}
+      -DOUTPUT=${output}
+      -P ${PROJECT_SOURCE_DIR}/cmake/gendispatcher.cmake
+    DEPENDS ${spec} ${PROJECT_SOURCE_DIR}/cmake/gendispatcher.cmake
+    COMMENT "Generating the ${name} route dispatcher"
+  )
+endfunction()
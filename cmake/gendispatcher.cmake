@@ -0,0 +1,195 @@
+# Route dispatcher generator, see dispatcher.cmake
+#
+# usage: cmake -DNAME=<name> -DSPEC=<spec> -DOUTPUT=<output> -P <this file>
+#
+# the generated dispatcher switches on the path length, then compares the
+# candidate paths of that length using memcmp and finally the method masks.
+# so routing is a straight-line code with no runtime table.
+cmake_minimum_required(VERSION 3.7)
+
+
+set(knownmethods GET HEAD POST PUT DELETE PATCH OPTIONS CONNECT TRACE)
+set(routepattern
+  "^[ \t]*CARROT_ROUTE\\([ \t]*([A-Z|]+)[ \t]*,[ \t]*\"([^\"]+)\"[ \t]*,[ \t]*([A-Za-z_][A-Za-z0-9_]*)[ \t]*\\)")
+
+
+file(STRINGS ${SPEC} lines)
+set(methods)
+set(paths)
+set(handlers)
+set(lengths)
+set(count 0)
+foreach (line IN LISTS lines)
+  if (line MATCHES "^[ \t]*$" OR line MATCHES "^[ \t]*(#|//)")
+    continue()
+  endif ()
+
+  if (NOT line MATCHES "${routepattern}")
+    message(FATAL_ERROR "${SPEC}: invalid route: ${line}")
+  endif ()
+
+  set(method ${CMAKE_MATCH_1})
+  set(path ${CMAKE_MATCH_2})
+  set(handler ${CMAKE_MATCH_3})
+  if (path MATCHES "[:*]")
+    message(FATAL_ERROR "${SPEC}: path parameters are not supported: ${path}")
+  endif ()
+
+  string(REPLACE "|" ";" names ${method})
+  foreach (m IN LISTS names)
+    if (NOT m IN_LIST knownmethods)
+      message(FATAL_ERROR "${SPEC}: unknown method: ${m}")
+    endif ()
+  endforeach ()
+
+  string(LENGTH "${path}" len)
+  list(APPEND methods ${method})
+  list(APPEND paths ${path})
+  list(APPEND handlers ${handler})
+  list(APPEND lengths ${len})
+  math(EXPR count "${count} + 1")
+endforeach ()
+
+
+if (count EQUAL 0)
+  message(FATAL_ERROR "${SPEC}: no routes")
+endif ()
+
+
+# GET|HEAD -> CARROT_METHOD_GET | CARROT_METHOD_HEAD
+function(methodmask var method)
+  string(REGEX REPLACE "([A-Z]+)" "CARROT_METHOD_\\1" mask ${method})
+  string(REPLACE "|" " | " mask ${mask})
+  set(${var} ${mask} PARENT_SCOPE)
+endfunction()
+
+
+get_filename_component(specname ${SPEC} NAME)
+math(EXPR last "${count} - 1")
+set(out "/* generated from ${specname} by carrot_dispatcher(), do not edit */\n")
+string(APPEND out "/* standard */\n#include <string.h>\n\n")
+string(APPEND out "/* local public */\n#include \"carrot/server.h\"\n\n\n")
+
+
+# handler declarations
+set(uniquehandlers ${handlers})
+list(REMOVE_DUPLICATES uniquehandlers)
+foreach (h IN LISTS uniquehandlers)
+  string(APPEND out "int\n${h}(struct carrot_connection *c, void *ptr);\n\n\n")
+endforeach ()
+
+
+# tables, indexed by the route id
+string(APPEND out "static const unsigned int _methods[] = {\n")
+foreach (i RANGE ${last})
+  list(GET methods ${i} m)
+  methodmask(mask ${m})
+  string(APPEND out "    ${mask},\n")
+endforeach ()
+string(APPEND out "};\n\n\n")
+
+string(APPEND out "static const char *const _paths[] = {\n")
+foreach (i RANGE ${last})
+  list(GET paths ${i} p)
+  string(APPEND out "    \"${p}\",\n")
+endforeach ()
+string(APPEND out "};\n\n\n")
+
+string(APPEND out "static const carrot_handler_t _handlers[] = {\n")
+foreach (i RANGE ${last})
+  list(GET handlers ${i} h)
+  string(APPEND out "    ${h},\n")
+endforeach ()
+string(APPEND out "};\n\n\n")
+
+
+# switch on length, memcmp the paths, compare the methods
+set(maxlength 0)
+foreach (len IN LISTS lengths)
+  if (len GREATER maxlength)
+    set(maxlength ${len})
+  endif ()
+endforeach ()
+
+string(APPEND out "static int\n")
+string(APPEND out "_find(enum carrot_method method, const char *path, ")
+string(APPEND out "const char **allow) {\n")
+string(APPEND out "    switch (strlen(path)) {\n")
+foreach (len RANGE 1 ${maxlength})
+  if (NOT len IN_LIST lengths)
+    continue()
+  endif ()
+
+  string(APPEND out "        case ${len}:\n")
+  set(done)
+  foreach (i RANGE ${last})
+    list(GET lengths ${i} l)
+    list(GET paths ${i} p)
+    if ((NOT l EQUAL len) OR (p IN_LIST done))
+      continue()
+    endif ()
+    list(APPEND done ${p})
+
+    string(APPEND out "            if (memcmp(path, \"${p}\", ${len}) == 0) {\n")
+    set(allowed)
+    set(get -1)
+    foreach (j RANGE ${i} ${last})
+      list(GET paths ${j} pj)
+      if (NOT pj STREQUAL p)
+        continue()
+      endif ()
+
+      list(GET methods ${j} m)
+      methodmask(mask ${m})
+      string(REPLACE "|" ";" names ${m})
+      list(APPEND allowed ${names})
+      if (("GET" IN_LIST names) AND (get EQUAL -1))
+        set(get ${j})
+      endif ()
+
+      string(APPEND out "                if (method & (${mask})) {\n")
+      string(APPEND out "                    return ${j};\n")
+      string(APPEND out "                }\n")
+    endforeach ()
+
+    # the GET handler serves the HEAD requests
+    if (NOT get EQUAL -1)
+      list(APPEND allowed HEAD)
+      string(APPEND out "                if (method == CARROT_METHOD_HEAD) {\n")
+      string(APPEND out "                    return ${get};\n")
+      string(APPEND out "                }\n")
+    endif ()
+
+    set(allow)
+    foreach (m IN LISTS knownmethods)
+      if (m IN_LIST allowed)
+        list(APPEND allow ${m})
+      endif ()
+    endforeach ()
+    string(REPLACE ";" ", " allow "${allow}")
+    string(APPEND out "                *allow = \"Allow: ${allow}\\r\\n\";\n")
+    string(APPEND out "                return -1;\n")
+    string(APPEND out "            }\n")
+  endforeach ()
+  string(APPEND out "            return -1;\n")
+endforeach ()
+string(APPEND out "    }\n\n    return -1;\n}\n\n\n")
+
+
+string(APPEND out "const struct carrot_dispatcher ${NAME} = {\n")
+string(APPEND out "    .find = _find,\n")
+string(APPEND out "    .methods = _methods,\n")
+string(APPEND out "    .paths = _paths,\n")
+string(APPEND out "    .handlers = _handlers,\n")
+string(APPEND out "    .count = ${count},\n")
+string(APPEND out "};\n")
+
+
+# avoid touching the output if nothing is changed
+if (EXISTS ${OUTPUT})
+  file(READ ${OUTPUT} old)
+  if (old STREQUAL out)
+    return()
+  endif ()
+endif ()
+file(WRITE ${OUTPUT} "${out}")
@@ -1 +1,2 @@
-set(CONFIG_CARROT_SERVER_MAXROUTES 32)
+# connection timeouts resolution (milliseconds)
+set(CONFIG_CARROT_TIMER_TICKMS 100)
@@ -18,6 +18,7 @@
  */
 /* standard */
 #include <stddef.h>
+#include <stdio.h>
 
 /* thirdparty */
 #include <clog.h>
@@ -75,26 +76,81 @@ _chatA(struct carrot_connection *c, void *ptr) {
 
 static int
 _streamA(struct carrot_connection *c, void *ptr) {
-    struct chttp_packet p;
-
-    ERR(chttp_packet_allocate(&p, 1, 1, CHTTP_TE_NONE));
-    ERR(chttp_packet_startresponse(&p, 200, NULL));
-    ERR(chttp_packet_contenttype(&p, "text/plain", "utf-8"));
-    ERR(chttp_packet_transferencoding(&p, CHTTP_TE_CHUNKED));
-    ERR(chttp_packet_close(&p));
+    /* chunked, and compressed when the client accepts it */
+    ASSRT(0 < carrot_server_streamA(c, 200, "text/plain; charset=utf-8"));
 
     /* first chunk */
-    ERR(chttp_packet_writef(&p, "Foo %s", "Bar"));
-    ASSRT(0 < carrot_connection_sendpacketA(c, &p));
+    ASSRT(0 < carrot_server_streamwriteA(c, "Foo Bar", 7));
 
     /* second chunk */
-    ERR(chttp_packet_writef(&p, " "));
-    ERR(chttp_packet_writef(&p, "Baz %s", "Qux"));
-    ERR(chttp_packet_writef(&p, "\r\n"));
-    ASSRT(0 < carrot_connection_sendpacketA(c, &p));
+    ASSRT(0 < carrot_server_streamwriteA(c, " Baz Qux\r\n", 10));
 
     /* terminate */
-    ASSRT(0 < carrot_connection_sendpacketA(c, &p));
+    return carrot_server_streamendA(c);
+}
+
+
+static int
+_uploadA(struct carrot_connection *c, void *ptr) {
+    const char *buff;
+    ssize_t bytes;
+    size_t total = 0;
+    char text[32];
+
+    if (c->bodyfd != -1) {
+        /* larger than the spillover, already received into a temporary
+         * file */
+        total = c->bodyreceived;
+    }
+    else {
+        /* consumed segment by segment, length-delimited or chunked */
+        while ((bytes = carrot_connection_recvbodyA(c, &buff)) > 0) {
+            total += bytes;
+        }
+
+        if (bytes < 0) {
+            return -1;
+        }
+    }
+
+    snprintf(text, sizeof(text), "%zu bytes received", total);
+    carrot_server_responseA(c, 200, NULL, text, -1, CARROT_SRF_APPENDCRLF);
+    return 0;
+}
+
+
+/* runs on the offload thread pool */
+static int
+_fib(void *arg) {
+    unsigned long *n = arg;
+    unsigned long a = 0;
+    unsigned long b = 1;
+    unsigned long t;
+
+    while ((*n)--) {
+        t = a + b;
+        a = b;
+        b = t;
+    }
+
+    *n = a;
+    return 0;
+}
+
+
+static int
+_fibA(struct carrot_connection *c, void *ptr) {
+    unsigned long n = 90;
+    char text[32];
+
+    /* only this coroutine is suspended until the job is done */
+    if (carrot_server_offloadA(c, _fib, &n)) {
+        return carrot_server_rejectA(c, 503, NULL) < 0? -1: 0;
+    }
+
+    snprintf(text, sizeof(text), "%lu", n);
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, text, -1,
+                CARROT_SRF_APPENDCRLF));
     return 0;
 }
 
@@ -111,20 +167,34 @@ _indexA(struct carrot_connection *c, void *ptr) {
 int
 main() {
     carrot_server_t srv;
+    struct carrot_route_options chat = {
+        /* the whole chunk must fit in the input ring */
+        .ringpages = 16,
+    };
+    struct carrot_route_options upload = {
+        .bodymax = 1024 * 1024 * 1024,
+        .spillover = 64 * 1024,
+    };
     clog_verbositylevel = CLOG_DEBUG;
     struct carrot_server_config config;
 
     /* fill config variable with the default values, and override it */
     carrot_server_makedefaults(&config);
-    config.connectionbuffer_mempages = 16;
+    config.compression_level = 6;
+    config.compression_minsize = 0;
+    config.offload_threads = 2;
 
     /* create a server */
     srv = carrot_server_new(&config);
 
     /* add some routes */
-    carrot_server_route(srv, "POST", "/chat", _chatA, NULL);
-    carrot_server_route(srv, "GET", "/stream", _streamA, NULL);
-    carrot_server_route(srv, "GET", "/", _indexA, NULL);
+    carrot_server_routex(srv, CARROT_METHOD_POST, "/chat", _chatA, NULL,
+            &chat);
+    carrot_server_route(srv, CARROT_METHOD_GET, "/stream", _streamA, NULL);
+    carrot_server_routex(srv, CARROT_METHOD_POST | CARROT_METHOD_PUT,
+            "/upload", _uploadA, NULL, &upload);
+    carrot_server_route(srv, CARROT_METHOD_GET, "/fib", _fibA, NULL);
+    carrot_server_route(srv, CARROT_METHOD_GET, "/", _indexA, NULL);
 
     /* handover the process to server's entrypoint */
     return carrot_server_main(srv);
@@ -28,6 +28,40 @@
 #include "carrot/addr.h"
 
 
+/* maximum number of vectors accepted by carrot_connection_writevA() */
+#define CARROT_CONNECTION_IOVMAX 16
+
+
+/* interned request methods, usable as masks when registering the routes,
+ * e.g. CARROT_METHOD_GET | CARROT_METHOD_POST. the extension methods are
+ * all mapped to the CARROT_METHOD_EXTENSION, so the handler must check the
+ * request's verb. */
+enum carrot_method {
+    CARROT_METHOD_UNKNOWN = 0,
+    CARROT_METHOD_GET = 0x1,
+    CARROT_METHOD_HEAD = 0x2,
+    CARROT_METHOD_POST = 0x4,
+    CARROT_METHOD_PUT = 0x8,
+    CARROT_METHOD_DELETE = 0x10,
+    CARROT_METHOD_PATCH = 0x20,
+    CARROT_METHOD_OPTIONS = 0x40,
+    CARROT_METHOD_CONNECT = 0x80,
+    CARROT_METHOD_TRACE = 0x100,
+    CARROT_METHOD_EXTENSION = 0x200,
+};
+
+
+/* resumable state of the header reception, see recvheaderA */
+struct carrot_headerscan {
+    /* bytes after the reader pointer already visited */
+    size_t scanned;
+
+    /* start of the current line and the number of validated lines */
+    size_t line;
+    unsigned int lines;
+};
+
+
 struct carrot_connection {
     int fd;
     union saddr peer;
@@ -36,6 +70,36 @@ struct carrot_connection {
         struct chttp_request *request;
         struct chttp_response *response;
     };
+
+    /* optional output queue, while corked, the outgoing packets are
+     * accumulated to be sent later using a single write. */
+    struct mrb *out;
+    int corked;
+
+    /* optional, called after each write making progress, e.g. to extend the
+     * write timeout while a slow peer is still receiving */
+    void (*onprogress)(struct carrot_connection *c);
+
+    /* unread bytes of the current request body, -1: chunked */
+    ssize_t bodyremain;
+
+    /* chunked body: unread bytes of the current chunk */
+    size_t chunkremain;
+
+    /* maximum and received (or declared) size of the current request body,
+     * see recvbodyA. zero: unlimited. */
+    size_t bodymax;
+    size_t bodyreceived;
+
+    /* unnamed temporary file holding the body received by the recvfileA,
+     * it's length is the bodyreceived. -1: none */
+    int bodyfd;
+
+    /* interned method of the current request */
+    enum carrot_method method;
+
+    /* incremental search and header validation state */
+    struct carrot_headerscan scan;
 };
 
 
@@ -43,10 +107,22 @@ ssize_t
 carrot_connection_recvchunkA(struct carrot_connection *c, const char **start);
 
 
+ssize_t
+carrot_connection_recvbodyA(struct carrot_connection *c, const char **start);
+
+
+ssize_t
+carrot_connection_recvfileA(struct carrot_connection *c, const char *dir);
+
+
 ssize_t
 carrot_connection_recvsearchA(struct carrot_connection *c, const char *s);
 
 
+ssize_t
+carrot_connection_recvheaderA(struct carrot_connection *c, size_t maxsize);
+
+
 int
 carrot_connection_recvallA(struct carrot_connection *c, char **out);
 
@@ -56,4 +132,23 @@ carrot_connection_sendpacketA(struct carrot_connection *c,
         struct chttp_packet *p);
 
 
+ssize_t
+carrot_connection_writeA(struct carrot_connection *c, const void *buff,
+        size_t len);
+
+
+ssize_t
+carrot_connection_writevA(struct carrot_connection *c,
+        const struct iovec *v, int vcount);
+
+
+ssize_t
+carrot_connection_sendfileA(struct carrot_connection *c, int fd,
+        off_t offset, size_t count);
+
+
+ssize_t
+carrot_connection_flushA(struct carrot_connection *c);
+
+
 #endif  // INCLUDE_CARROT_CONNECTION_H_
@@ -31,14 +31,133 @@
 
 typedef struct carrot_server *carrot_server_t;
 typedef int (*carrot_handler_t)(struct carrot_connection *c, void *ptr);
+typedef int (*carrot_offload_t)(void *arg);
 struct carrot_server_config {
     const char *bind;
+
+    /* listen backlog, capped by net.core.somaxconn */
     unsigned int backlog;
+
+    /* maximum number of connections accepted per listen socket readiness
+     * event, before yielding to the event loop */
+    unsigned int acceptbatch;
+
+    /* tcp listener options, zero: disabled.
+     * deferaccept: seconds to wait for the request data (TCP_DEFER_ACCEPT).
+     * fastopen: maximum length of pending TFO requests (TCP_FASTOPEN). */
+    unsigned int deferaccept;
+    unsigned int fastopen;
     unsigned int requestbuffer_mempages;
+
+    /* input ring of a connection starts with the connectionbuffer_mempages
+     * and grows on demand, doubling up to the connectionbuffer_maxpages */
     unsigned int connectionbuffer_mempages;
+    unsigned int connectionbuffer_maxpages;
 
-    // TODO: apply
+    /* output queue, used to send the pipelined responses at once */
+    unsigned int outputbuffer_mempages;
+
+    /* number of threads, each one runs it's own event loop and listen socket
+     * using SO_REUSEPORT. */
+    unsigned int workers;
+
+    /* number of forked worker processes, each one with it's own listen
+     * socket using SO_REUSEPORT, unix domain sockets are shared. the master
+     * process restarts crashed workers and forwards signals to them. each
+     * process runs the given number of workers. the carrot_server_stats()
+     * are per process. */
+    unsigned int processes;
+
+    /* maximum number of concurrent connections per worker, the acceptor
+     * stops accepting new connections when it's reached, zero: unlimited */
     unsigned int connections_max;
+
+    /* maximum number of idle connections kept per worker for reuse. the pool
+     * is filled at startup along with the buffers, and the pages are touched
+     * when connectionpool_prefault is set. */
+    unsigned int connectionpool_size;
+    int connectionpool_prefault;
+
+    /* the buffers (rings and request) are detached from the connections
+     * waiting for the next request, and at most bufferpool_size buffers of
+     * each kind and size are kept idle per worker for reuse. */
+    unsigned int bufferpool_size;
+
+    /* timeouts in milliseconds, zero: disabled.
+     * header: receiving the request header.
+     * body: handler execution, including receiving the request body.
+     * idle: waiting for the next request on a keep-alive connection.
+     * write: sending a response using carrot_server_responseA(). */
+    unsigned int timeout_header;
+    unsigned int timeout_body;
+    unsigned int timeout_idle;
+    unsigned int timeout_write;
+
+    /* maximum size of the request header, larger headers are rejected with
+     * 431 as soon as they exceed it. zero: bounded by the connection buffer
+     * only. */
+    size_t header_maxsize;
+
+    /* directory of the unnamed temporary files holding the spilled request
+     * bodies, the file system must support the O_TMPFILE. */
+    const char *tmpdir;
+
+    /* per worker in-memory cache of the static files smaller than the
+     * assetcache_filemax, including the rendered headers and the gzip
+     * variants, bounded by the assetcache_size bytes. zero: disabled. */
+    size_t assetcache_size;
+    size_t assetcache_filemax;
+
+    /* per worker cache of the open static files, up to fdcache_size
+     * descriptors. the cached metadata is trusted for fdcache_ttl
+     * milliseconds before checking the path again. zero: disabled. */
+    unsigned int fdcache_size;
+    unsigned int fdcache_ttl;
+
+    /* on the fly gzip/deflate compression of the responses, negotiated using
+     * the Accept-Encoding header. level: zlib compression level, zero:
+     * disabled. minsize: smaller responses are sent as is. types: NULL
+     * terminated list of the compressible content types, NULL: text, json,
+     * javascript, xml and wasm. at most compression_poolsize idle deflate
+     * states are kept per worker for reuse. */
+    int compression_level;
+    size_t compression_minsize;
+    const char *const *compression_types;
+    unsigned int compression_poolsize;
+
+    /* per process pool of threads running the carrot_server_offloadA()
+     * jobs, at most offload_queuemax jobs are waiting for a free thread,
+     * zero: unlimited. offload_threads zero: the jobs run in place. */
+    unsigned int offload_threads;
+    unsigned int offload_queuemax;
+};
+
+
+struct carrot_server_stats {
+    /* currently open connections */
+    unsigned long connections;
+    unsigned long accepted;
+    unsigned long closed;
+
+    /* how many times the acceptor paused because of connections_max or the
+     * open files limit */
+    unsigned long capped;
+
+    /* connections closed by the header, body, idle or write timeouts */
+    unsigned long timedout;
+
+    /* bytes of the buffers attached to the connections, the average per
+     * open connection, and the idle ones kept in the pools */
+    unsigned long buffers;
+    unsigned long buffers_perconnection;
+    unsigned long buffers_idle;
+
+    /* offloaded jobs waiting for a free thread, running, done, and the
+     * ones rejected because of the offload_queuemax */
+    unsigned long offload_queued;
+    unsigned long offload_running;
+    unsigned long offload_completed;
+    unsigned long offload_rejected;
 };
 
 
@@ -47,6 +166,51 @@ enum {
 };
 
 
+/* build-time compiled routes, see the carrot_dispatcher() in the
+ * cmake/dispatcher.cmake. the find function returns the index of the
+ * matching route or -1, and sets the allow to the rendered Allow header if
+ * the path is matched but not the method. */
+struct carrot_dispatcher {
+    int (*find)(enum carrot_method method, const char *path,
+            const char **allow);
+    const unsigned int *methods;
+    const char *const *paths;
+    const carrot_handler_t *handlers;
+    unsigned int count;
+};
+
+
+struct carrot_route_options {
+    /* NULL terminated list of the extra header lines, without the CRLF,
+     * rendered once and sent with every carrot_server_responseA() of the
+     * route, e.g. "Cache-Control: no-store". */
+    const char *const *headers;
+
+    /* maximum size of the request body, larger bodies are rejected with 413
+     * before calling the handler when the Content-Length is known, or when
+     * the carrot_connection_recvbodyA() reaches it for the chunked ones.
+     * zero: unlimited. */
+    size_t bodymax;
+
+    /* bodies larger than the spillover, and all the chunked ones, are
+     * received into an unnamed temporary file inside the config->tmpdir
+     * before calling the handler, see carrot_connection_recvfileA().
+     * zero: disabled. */
+    size_t spillover;
+
+    /* stricter limit of the request header size than the
+     * config->header_maxsize, which still applies while receiving the
+     * header, larger headers are rejected with 431. zero: disabled. */
+    size_t header_maxsize;
+
+    /* size of the input ring in pages, the connection's ring is upgraded
+     * after routing, before calling the handler, so the routes buffering
+     * the whole body do not need a large connectionbuffer_mempages for all
+     * the connections. zero: connectionbuffer_mempages. */
+    unsigned int ringpages;
+};
+
+
 extern const struct carrot_server_config carrot_server_defaultconfig;
 
 
@@ -63,10 +227,31 @@ carrot_server_free(struct carrot_server *s);
 
 
 int
-carrot_server_route(struct carrot_server *s, const char *verb,
+carrot_server_route(struct carrot_server *s, unsigned int methods,
         const char *path, carrot_handler_t handler, void *ptr);
 
 
+int
+carrot_server_routex(struct carrot_server *s, unsigned int methods,
+        const char *path, carrot_handler_t handler, void *ptr,
+        const struct carrot_route_options *options);
+
+
+int
+carrot_server_dispatcher(struct carrot_server *s,
+        const struct carrot_dispatcher *d);
+
+
+const char *
+carrot_server_param(struct carrot_connection *c, const char *name,
+        size_t *len);
+
+
+int
+carrot_server_static(struct carrot_server *s, const char *path,
+        const char *root);
+
+
 ssize_t
 carrot_server_responseA(struct carrot_connection *c, int status,
         const char *text, const char *content, size_t contentlen, int flags);
@@ -77,10 +262,34 @@ carrot_server_rejectA(struct carrot_connection *c, int status,
         const char *text);
 
 
+ssize_t
+carrot_server_streamA(struct carrot_connection *c, int status,
+        const char *contenttype);
+
+
+ssize_t
+carrot_server_streamwriteA(struct carrot_connection *c, const char *data,
+        size_t len);
+
+
+int
+carrot_server_streamendA(struct carrot_connection *c);
+
+
+int
+carrot_server_offloadA(struct carrot_connection *c, carrot_offload_t fn,
+        void *arg);
+
+
 int
 carrot_serverA(struct carrot_server *s);
 
 
+void
+carrot_server_stats(struct carrot_server *s,
+        struct carrot_server_stats *out);
+
+
 int
 carrot_server_main(struct carrot_server *s);
 
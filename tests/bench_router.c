@@ -0,0 +1,168 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* local private */
+#include "router.h"
+
+
+#define ROUNDS 1000000
+#define LINEARMAX 64
+
+
+/* generated from the routes.def */
+extern const struct carrot_dispatcher testdispatcher;
+
+
+/* the linear router, as it was before the radix trie */
+struct linear {
+    enum carrot_method method;
+    const char *path;
+};
+static struct linear _linear[LINEARMAX];
+static unsigned int _linearcount;
+
+
+int
+routes_listA(struct carrot_connection *c, void *ptr) {
+    return 0;
+}
+
+
+int
+routes_createA(struct carrot_connection *c, void *ptr) {
+    return 0;
+}
+
+
+int
+routes_deleteA(struct carrot_connection *c, void *ptr) {
+    return 0;
+}
+
+
+static int
+_linear_find(enum carrot_method method, const char *path) {
+    unsigned int i;
+
+    for (i = 0; i < _linearcount; i++) {
+        if ((strcmp(_linear[i].path, path) == 0) &&
+                (_linear[i].method & method)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+static double
+_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/* routes from the beginning, the middle and the end of the spec, plus a
+ * miss */
+static const struct {
+    enum carrot_method method;
+    const char *path;
+} _requests[] = {
+    {CARROT_METHOD_GET, "/api/v1/users"},
+    {CARROT_METHOD_DELETE, "/api/v1/orders"},
+    {CARROT_METHOD_POST, "/api/v1/tokens"},
+    {CARROT_METHOD_GET, "/health"},
+    {CARROT_METHOD_GET, "/api/v1/notfound"},
+};
+#define REQUESTS (sizeof(_requests) / sizeof(_requests[0]))
+
+
+int
+main() {
+    unsigned int i;
+    unsigned int j;
+    double start;
+    volatile long sink = 0;
+    const char *allow;
+    struct router_params params;
+    struct router trie = {
+        .root = NULL,
+    };
+    const struct carrot_dispatcher *d = &testdispatcher;
+
+    /* build the same route table for all the routers */
+    for (i = 0; i < d->count; i++) {
+        if (_linearcount == LINEARMAX) {
+            return EXIT_FAILURE;
+        }
+
+        _linear[_linearcount].method = d->methods[i];
+        _linear[_linearcount].path = d->paths[i];
+        _linearcount++;
+        if (router_append(&trie, d->methods[i], d->paths[i],
+                    d->handlers[i], NULL) == NULL) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%u routes, %d rounds of %zu lookups\n", d->count, ROUNDS,
+            REQUESTS);
+
+    start = _now();
+    for (i = 0; i < ROUNDS; i++) {
+        for (j = 0; j < REQUESTS; j++) {
+            sink += _linear_find(_requests[j].method, _requests[j].path);
+        }
+    }
+    printf("linear:     %6.1f ns/lookup\n",
+            (_now() - start) / (ROUNDS * REQUESTS));
+
+    start = _now();
+    for (i = 0; i < ROUNDS; i++) {
+        for (j = 0; j < REQUESTS; j++) {
+            sink += (long)router_find(&trie, _requests[j].method,
+                    _requests[j].path, &params, &allow);
+        }
+    }
+    printf("trie:       %6.1f ns/lookup\n",
+            (_now() - start) / (ROUNDS * REQUESTS));
+
+    start = _now();
+    for (i = 0; i < ROUNDS; i++) {
+        for (j = 0; j < REQUESTS; j++) {
+            sink += d->find(_requests[j].method, _requests[j].path,
+                    &allow);
+        }
+    }
+    printf("dispatcher: %6.1f ns/lookup\n",
+            (_now() - start) / (ROUNDS * REQUESTS));
+
+    router_deinit(&trie);
+    return EXIT_SUCCESS;
+}
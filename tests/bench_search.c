@@ -0,0 +1,207 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* local private */
+#include "search.h"
+
+
+#define ROUNDS 100000
+#define SEGMENT 64
+
+
+/* a typical browser request header */
+static const char _header[] =
+    "GET /api/v1/users/1234/orders?page=2&size=50 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 "
+        "Firefox/128.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,"
+        "*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Referer: https://www.example.com/api/v1/users/1234\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: session=2b0f7c6a9d1e4f3b8a5c0d7e6f1a2b3c; theme=dark; "
+        "lang=en; _ga=GA1.2.1234567890.1234567890\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Priority: u=0, i\r\n"
+    "\r\n";
+#define HEADERSIZE (sizeof(_header) - 1)
+
+
+static double
+_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/* the previous recvsearchA: memmem over the whole input on each read */
+static ssize_t
+_memmem_rescan(size_t segment) {
+    size_t used;
+    const char *found;
+
+    for (used = segment; ; used += segment) {
+        used = used < HEADERSIZE? used: HEADERSIZE;
+        found = memmem(_header, used, "\r\n\r\n", 4);
+        if (found) {
+            return found - _header;
+        }
+    }
+}
+
+
+/* the current recvsearchA: resume from the previously scanned offset */
+static ssize_t
+_incremental(search_kernel_t kernel, size_t segment) {
+    size_t used;
+    size_t scanned = 0;
+    ssize_t found;
+
+    for (used = segment; ; used += segment) {
+        used = used < HEADERSIZE? used: HEADERSIZE;
+        if ((used - scanned) < 4) {
+            continue;
+        }
+
+        found = kernel(_header + scanned, used - scanned);
+        if (found >= 0) {
+            return scanned + found;
+        }
+        scanned = used - 3;
+    }
+}
+
+
+static void
+_bench(const char *name, search_kernel_t kernel, size_t segment) {
+    unsigned int i;
+    double start;
+    volatile ssize_t sink = 0;
+
+    start = _now();
+    for (i = 0; i < ROUNDS; i++) {
+        sink += kernel? _incremental(kernel, segment):
+            _memmem_rescan(segment);
+    }
+    printf("%-8s %4zu bytes/read: %8.1f ns/header\n", name, segment,
+            (_now() - start) / ROUNDS);
+}
+
+
+/* the previous headscan: memchr for the LF, then a lookup per byte */
+static const unsigned char _ctls[256] = {
+    [0 ... '\t' - 1] = 1,
+    ['\t' + 1 ... 0x1f] = 1,
+    [0x7f] = 1,
+};
+
+
+static ssize_t
+_memchr_lines() {
+    const char *cur = _header;
+    const char *lf;
+    ssize_t lines = 0;
+
+    while ((lf = memchr(cur, '\n', HEADERSIZE - (cur - _header)))) {
+        for (; cur < (lf - 1); cur++) {
+            if (_ctls[(unsigned char)*cur]) {
+                return -1;
+            }
+        }
+        cur = lf + 1;
+        lines++;
+    }
+
+    return lines;
+}
+
+
+/* the current headscan: the first CTL of each line is its CR */
+static ssize_t
+_ctl_lines(search_ctlkernel_t kernel) {
+    size_t cur = 0;
+    ssize_t found;
+    ssize_t lines = 0;
+
+    while ((found = kernel(_header + cur, HEADERSIZE - cur, 1)) != -1) {
+        cur += found + 2;
+        lines++;
+    }
+
+    return lines;
+}
+
+
+static void
+_bench_lines(const char *name, search_ctlkernel_t kernel) {
+    unsigned int i;
+    double start;
+    volatile ssize_t sink = 0;
+
+    start = _now();
+    for (i = 0; i < ROUNDS; i++) {
+        sink += kernel? _ctl_lines(kernel): _memchr_lines();
+    }
+    printf("%-8s lines: %8.1f ns/header\n", name,
+            (_now() - start) / ROUNDS);
+}
+
+
+int
+main() {
+    size_t segment;
+
+    printf("%zu bytes header, %d rounds\n", HEADERSIZE, ROUNDS);
+    for (segment = SEGMENT; segment <= HEADERSIZE; segment *= 4) {
+        _bench("memmem", NULL, segment);
+        _bench("scalar", search_crlfcrlf_scalar, segment);
+#if defined(__x86_64__) || defined(__i386__)
+        _bench("sse2", search_crlfcrlf_sse2, segment);
+        if (__builtin_cpu_supports("avx2")) {
+            _bench("avx2", search_crlfcrlf_avx2, segment);
+        }
+#endif
+    }
+    _bench("memmem", NULL, HEADERSIZE);
+    _bench("dispatch", search_crlfcrlf, HEADERSIZE);
+
+    _bench_lines("memchr", NULL);
+    _bench_lines("scalar", search_ctl_scalar);
+#if defined(__x86_64__) || defined(__i386__)
+    _bench_lines("sse2", search_ctl_sse2);
+    if (__builtin_cpu_supports("avx2")) {
+        _bench_lines("avx2", search_ctl_avx2);
+    }
+#endif
+    _bench_lines("dispatch", search_ctl);
+
+    return EXIT_SUCCESS;
+}
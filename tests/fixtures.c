@@ -34,12 +34,15 @@
 /* local private */
 #include "common.h"
 #include "server.h"
+#include "asset.h"
+#include "fdcache.h"
+#include "pool.h"
 
 /* test private */
 #include "fixtures.h"
 
 
-#define BUFFSIZE 4096
+#define BUFFSIZE 16384
 char content[BUFFSIZE];
 static char _buff[BUFFSIZE];
 static struct chttp_response *_resp  = NULL;
@@ -47,7 +50,7 @@ static struct carrot_server _carrot = {
     .config = &carrot_server_defaultconfig,
     .listenfd = -1,
     .router = {
-        .count = 0,
+        .root = NULL,
     }
 };
 
@@ -158,8 +161,37 @@ serverfixture_setup(unsigned char pages) {
         return NULL;
     }
 
+    if (connpool_init(&_carrot.pool, _carrot.config)) {
+        return NULL;
+    }
+
+    if (_carrot.config->offload_threads) {
+        _carrot.offload = offload_new(_carrot.config->offload_threads,
+                _carrot.config->offload_queuemax);
+        if (_carrot.offload == NULL) {
+            connpool_deinit(&_carrot.pool);
+            return NULL;
+        }
+    }
+
+    if (_carrot.config->assetcache_size) {
+        _carrot.assets = assetcache_new(_carrot.config->assetcache_size,
+                _carrot.config->assetcache_filemax);
+        if (_carrot.assets == NULL) {
+            offload_free(_carrot.offload);
+            _carrot.offload = NULL;
+            connpool_deinit(&_carrot.pool);
+            return NULL;
+        }
+    }
+
     _resp = chttp_response_new(pages);
     if (_resp == NULL) {
+        assetcache_free(_carrot.assets);
+        _carrot.assets = NULL;
+        offload_free(_carrot.offload);
+        _carrot.offload = NULL;
+        connpool_deinit(&_carrot.pool);
         return NULL;
     }
 
@@ -169,11 +201,26 @@ serverfixture_setup(unsigned char pages) {
 
 void
 serverfixture_teardown() {
+    struct static_dir *d;
+
     if (_resp) {
         chttp_response_free(_resp);
         _resp = NULL;
     }
 
+    while (_carrot.statics) {
+        d = _carrot.statics;
+        _carrot.statics = d->next;
+        static_dir_free(d);
+    }
+
+    assetcache_free(_carrot.assets);
+    fdcache_free(_carrot.fds);
+    compresspool_deinit(&_carrot.compressors);
+    offload_free(_carrot.offload);
+    offload_waitfds_deinit(&_carrot.waitfds);
+    connpool_deinit(&_carrot.pool);
+    router_deinit(&_carrot.router);
     memset(&_carrot, 0, sizeof(_carrot));
     _carrot.listenfd = -1;
     _carrot.config = &carrot_server_defaultconfig;
@@ -227,8 +274,46 @@ request(const char *fmt, ...) {
 }
 
 
+void
+serverconfig(const struct carrot_server_config *config) {
+    _carrot.config = config;
+}
+
+
 int
-route(const char *verb, const char *path, carrot_handler_t handler,
+route(unsigned int methods, const char *path, carrot_handler_t handler,
         void *ptr) {
-    return carrot_server_route(&_carrot, verb, path, handler, ptr);
+    return carrot_server_route(&_carrot, methods, path, handler, ptr);
+}
+
+
+int
+routex(unsigned int methods, const char *path, carrot_handler_t handler,
+        void *ptr, const struct carrot_route_options *options) {
+    return carrot_server_routex(&_carrot, methods, path, handler, ptr,
+            options);
+}
+
+
+int
+dispatcher(const struct carrot_dispatcher *d) {
+    return carrot_server_dispatcher(&_carrot, d);
+}
+
+
+int
+staticdir(const char *path, const char *root) {
+    return carrot_server_static(&_carrot, path, root);
+}
+
+
+/* invalidate the cached assets of the changed files, the ticker does it
+ * in the server */
+int
+staticnotify() {
+    if (_carrot.assets == NULL) {
+        return -1;
+    }
+
+    return assetcache_notify(_carrot.assets);
 }
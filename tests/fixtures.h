@@ -44,9 +44,30 @@ void
 serverfixture_teardown();
 
 
+void
+serverconfig(const struct carrot_server_config *config);
+
+
 int
-route(const char *verb, const char *path, carrot_handler_t handler,
+route(unsigned int methods, const char *path, carrot_handler_t handler,
         void *ptr);
 
 
+int
+routex(unsigned int methods, const char *path, carrot_handler_t handler,
+        void *ptr, const struct carrot_route_options *options);
+
+
+int
+dispatcher(const struct carrot_dispatcher *d);
+
+
+int
+staticdir(const char *path, const char *root);
+
+
+int
+staticnotify();
+
+
 #endif  // TESTS_FIXTURES_H_
@@ -0,0 +1,111 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdlib.h>
+
+/* thirdparty */
+#include <cutest.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* test private */
+#include "tests/fixtures.h"
+
+
+/* count the heap allocations using the glibc's internal entry points */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+static int _counting;
+static int _allocations;
+
+
+void *
+malloc(size_t size) {
+    _allocations += _counting;
+    return __libc_malloc(size);
+}
+
+
+void *
+calloc(size_t count, size_t size) {
+    _allocations += _counting;
+    return __libc_calloc(count, size);
+}
+
+
+void *
+realloc(void *ptr, size_t size) {
+    _allocations += _counting;
+    return __libc_realloc(ptr, size);
+}
+
+
+static int
+_startA(struct carrot_connection *c, void *ptr) {
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "Start", -1, 0));
+    _allocations = 0;
+    _counting = 1;
+    return 0;
+}
+
+
+static int
+_hitA(struct carrot_connection *c, void *ptr) {
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "Hit", -1, 0));
+    return 0;
+}
+
+
+static int
+_stopA(struct carrot_connection *c, void *ptr) {
+    _counting = 0;
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "Stop", -1, 0));
+    return 0;
+}
+
+
+static void
+test_alloc_steadystate() {
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_GET, "/start", _startA, NULL);
+    route(CARROT_METHOD_GET, "/hit", _hitA, NULL);
+    route(CARROT_METHOD_GET, "/stop", _stopA, NULL);
+
+    /* parse, route, respond and reject the pipelined requests between the
+     * start and stop handlers without touching the heap */
+    _allocations = -1;
+    eqint(200, request("GET /start HTTP/1.1\r\n\r\n"
+                "GET /hit HTTP/1.1\r\n\r\n"
+                "GET /notfound HTTP/1.1\r\n\r\n"
+                "GET /hit HTTP/1.1\r\nConnection: keep-alive\r\n\r\n"
+                "GET /stop HTTP/1.1\r\n\r\n"));
+    eqint(0, _allocations);
+
+    serverfixture_teardown();
+}
+
+
+int
+main() {
+    test_alloc_steadystate();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,234 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <string.h>
+
+/* posix */
+#include <unistd.h>
+
+/* thirdparty */
+#include <mrb.h>
+#include <cutest.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* test private */
+#include "tests/fixtures.h"
+
+
+static char _body[1024];
+static int _calls;
+
+
+static int
+_echoA(struct carrot_connection *c, void *ptr) {
+    const char *buff;
+    ssize_t bytes;
+    size_t total = 0;
+
+    _calls++;
+    while ((bytes = carrot_connection_recvbodyA(c, &buff)) > 0) {
+        ASSRT((total + bytes) < sizeof(_body));
+        memcpy(_body + total, buff, bytes);
+        total += bytes;
+    }
+    _body[total] = 0;
+
+    if (bytes < 0) {
+        return -1;
+    }
+
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "Ok", -1, 0));
+    return 0;
+}
+
+
+static int
+_fileA(struct carrot_connection *c, void *ptr) {
+    ssize_t bytes;
+
+    if (c->bodyfd == -1) {
+        /* below the spillover */
+        _body[0] = 0;
+        return _echoA(c, ptr);
+    }
+
+    _calls++;
+    bytes = read(c->bodyfd, _body + 1, sizeof(_body) - 2);
+    ASSRT(bytes == (ssize_t)c->bodyreceived);
+    _body[0] = '@';
+    _body[bytes + 1] = 0;
+
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "Ok", -1, 0));
+    return 0;
+}
+
+
+static int
+_ringA(struct carrot_connection *c, void *ptr) {
+    size_t size = mrb_used(&c->ring) + mrb_available(&c->ring);
+
+    ASSRT(size >= (size_t)(4 * getpagesize()));
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "Ok", -1, 0));
+    return 0;
+}
+
+
+static void
+test_body_contentlength() {
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_POST, "/", _echoA, NULL);
+
+    eqint(200, request("POST / HTTP/1.1\r\n"
+                "Content-Length: 9\r\n\r\n"
+                "foobarbaz"));
+    eqstr("foobarbaz", _body);
+
+    eqint(200, request("POST / HTTP/1.1\r\n\r\n"));
+    eqstr("", _body);
+
+    serverfixture_teardown();
+}
+
+
+static void
+test_body_chunked() {
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_POST, "/", _echoA, NULL);
+
+    eqint(200, request("POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n\r\n"
+                "3\r\nfoo\r\n"
+                "a;name=value\r\n0123456789\r\n"
+                "0\r\n"
+                "X-Trailer: bar\r\n\r\n"));
+    eqstr("foo0123456789", _body);
+
+    /* malformed chunks */
+    eqint(500, request("POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n\r\n"
+                "x\r\nfoo\r\n0\r\n\r\n"));
+    eqint(500, request("POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n\r\n"
+                "3\r\nfooo\r\n0\r\n\r\n"));
+
+    serverfixture_teardown();
+}
+
+
+static void
+test_body_max() {
+    struct carrot_route_options options = {
+        .bodymax = 8,
+    };
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    routex(CARROT_METHOD_POST, "/", _echoA, NULL, &options);
+
+    eqint(200, request("POST / HTTP/1.1\r\n"
+                "Content-Length: 8\r\n\r\n"
+                "foobarba"));
+    eqstr("foobarba", _body);
+
+    /* rejected before calling the handler */
+    _calls = 0;
+    eqint(413, request("POST / HTTP/1.1\r\n"
+                "Content-Length: 9\r\n\r\n"
+                "foobarbaz"));
+    eqint(0, _calls);
+
+    /* the chunked body is rejected as soon as the limit is reached */
+    eqint(413, request("POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n\r\n"
+                "3\r\nfoo\r\n6\r\nbarbaz\r\n0\r\n\r\n"));
+    eqint(1, _calls);
+    eqstr("foo", _body);
+
+    serverfixture_teardown();
+}
+
+
+static void
+test_body_spill() {
+    struct carrot_route_options options = {
+        .bodymax = 16,
+        .spillover = 4,
+    };
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    routex(CARROT_METHOD_POST, "/", _fileA, NULL, &options);
+
+    /* small bodies are not spilled */
+    eqint(200, request("POST / HTTP/1.1\r\n"
+                "Content-Length: 4\r\n\r\n"
+                "quux"));
+    eqstr("quux", _body);
+
+    eqint(200, request("POST / HTTP/1.1\r\n"
+                "Content-Length: 9\r\n\r\n"
+                "foobarbaz"));
+    eqstr("@foobarbaz", _body);
+
+    eqint(200, request("POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n\r\n"
+                "3\r\nfoo\r\n6\r\nbarbaz\r\n0\r\n\r\n"));
+    eqstr("@foobarbaz", _body);
+
+    /* the limit is applied while spilling */
+    _calls = 0;
+    eqint(413, request("POST / HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n\r\n"
+                "9\r\nfoobarbaz\r\n9\r\nfoobarbaz\r\n0\r\n\r\n"));
+    eqint(0, _calls);
+
+    serverfixture_teardown();
+}
+
+
+static void
+test_body_ringpages() {
+    struct carrot_route_options options = {
+        .ringpages = 4,
+    };
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_POST, "/small", _ringA, NULL);
+    routex(CARROT_METHOD_POST, "/large", _ringA, NULL, &options);
+
+    /* the input ring is upgraded after routing */
+    eqint(500, request("POST /small HTTP/1.1\r\n\r\n"));
+    eqint(200, request("POST /large HTTP/1.1\r\n"
+                "Content-Length: 3\r\n\r\nfoo"));
+
+    serverfixture_teardown();
+}
+
+
+int
+main() {
+    test_body_contentlength();
+    test_body_chunked();
+    test_body_max();
+    test_body_spill();
+    test_body_ringpages();
+    return EXIT_SUCCESS;
+}
@@ -70,7 +70,7 @@ static void
 test_request_chunked() {
     struct chttp_response *r = serverfixture_setup(1);
     isnotnull(r);
-    route("GET", "/", _indexA, NULL);
+    route(CARROT_METHOD_GET, "/", _indexA, NULL);
 
     eqint(200, request("GET / HTTP/1.1\r\n"
                 "Transfer-Encoding: chunked\r\n\r\n"
@@ -0,0 +1,249 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <string.h>
+
+/* thirdparty */
+#include <zlib.h>
+#include <cutest.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* local private */
+#include "compress.h"
+
+/* test private */
+#include "tests/fixtures.h"
+
+
+#define LARGE 65536
+static char _text[LARGE];
+static char _plain[LARGE + 1];
+
+
+/* decode the gzip or zlib stream of the given length into the _plain */
+static ssize_t
+_inflate(const char *in, size_t len, int wbits) {
+    z_stream zs = {0};
+    int ret;
+
+    ERR(inflateInit2(&zs, wbits) != Z_OK);
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = len;
+    zs.next_out = (Bytef *)_plain;
+    zs.avail_out = LARGE;
+    ret = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+    ERR(ret != Z_STREAM_END);
+
+    _plain[zs.total_out] = 0;
+    return zs.total_out;
+}
+
+
+static int
+_textA(struct carrot_connection *c, void *ptr) {
+    size_t len = (size_t)ptr;
+
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, _text, len, 0));
+    return 0;
+}
+
+
+static int
+_streamA(struct carrot_connection *c, void *ptr) {
+    ASSRT(0 < carrot_server_streamA(c, 200, ptr));
+    ASSRT(0 < carrot_server_streamwriteA(c, _text, 1000));
+    ASSRT(0 < carrot_server_streamwriteA(c, _text + 1000, 1000));
+    return carrot_server_streamendA(c);
+}
+
+
+static void
+test_compress_negotiate() {
+    eqint(COMPRESS_NONE, compress_negotiate(NULL));
+    eqint(COMPRESS_NONE, compress_negotiate("br"));
+    eqint(COMPRESS_NONE, compress_negotiate("gzip;q=0, deflate;q=0"));
+    eqint(COMPRESS_GZIP, compress_negotiate("deflate, gzip"));
+    eqint(COMPRESS_GZIP, compress_negotiate("*"));
+    eqint(COMPRESS_DEFLATE, compress_negotiate("deflate"));
+    eqint(COMPRESS_DEFLATE, compress_negotiate("gzip;q=0, deflate"));
+    eqstr("gzip", compress_codingname(COMPRESS_GZIP));
+    eqstr("deflate", compress_codingname(COMPRESS_DEFLATE));
+}
+
+
+static void
+test_compress_pool() {
+    struct compresspool pool = {0};
+    struct compressor *z;
+    struct compressor *z2;
+
+    /* compressed at once */
+    z = compressor_get(&pool, COMPRESS_GZIP, 6);
+    isnotnull(z);
+    istrue(compressor_fits(z, 2000));
+    compressor_input(z, _text, 2000);
+    eqint(0, compressor_run(z, Z_FINISH));
+    eqint(2000, _inflate(z->buff, z->len, 16 + MAX_WBITS));
+    eqint(0, memcmp(_text, _plain, 2000));
+    compressor_put(&pool, z, 1);
+    eqint(1, pool.count);
+
+    /* the idle state is reset and reused */
+    z2 = compressor_get(&pool, COMPRESS_GZIP, 6);
+    istrue(z == z2);
+    eqint(0, pool.count);
+    eqint(0, z->len);
+    compressor_input(z, "foo", 3);
+    eqint(0, compressor_run(z, Z_FINISH));
+    eqint(3, _inflate(z->buff, z->len, 16 + MAX_WBITS));
+    eqstr("foo", _plain);
+
+    /* the pool is full */
+    z2 = compressor_get(&pool, COMPRESS_DEFLATE, 6);
+    isnotnull(z2);
+    compressor_put(&pool, z, 1);
+    compressor_put(&pool, z2, 1);
+    eqint(1, pool.count);
+    compresspool_deinit(&pool);
+    eqint(0, pool.count);
+}
+
+
+static void
+test_compress_response() {
+    const char *types[] = {"text/html", NULL};
+    struct carrot_server_config config = carrot_server_defaultconfig;
+    struct chttp_response *r;
+    long length;
+
+    config.compression_level = 6;
+    config.compression_minsize = 100;
+    serverconfig(&config);
+    r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_GET, "/small", _textA, (void *)99);
+    route(CARROT_METHOD_GET, "/text", _textA, (void *)2000);
+    route(CARROT_METHOD_GET, "/large", _textA, (void *)LARGE);
+
+    /* not accepted by the client */
+    eqint(200, request("GET /text HTTP/1.1\r\n\r\n"));
+    isnull(chttp_headerset_get(&r->headers, "Content-Encoding"));
+    eqstr("Accept-Encoding", chttp_headerset_get(&r->headers, "Vary"));
+    eqint(2000, r->contentlength);
+
+    /* smaller than the minsize */
+    eqint(200, request("GET /small HTTP/1.1\r\n"
+                "Accept-Encoding: gzip\r\n\r\n"));
+    isnull(chttp_headerset_get(&r->headers, "Content-Encoding"));
+    eqstr("Accept-Encoding", chttp_headerset_get(&r->headers, "Vary"));
+    eqint(99, r->contentlength);
+
+    /* fits the compressor's buffer */
+    eqint(200, request("GET /text HTTP/1.1\r\n"
+                "Accept-Encoding: deflate, gzip\r\n\r\n"));
+    eqstr("gzip", chttp_headerset_get(&r->headers, "Content-Encoding"));
+    eqstr("Accept-Encoding", chttp_headerset_get(&r->headers, "Vary"));
+    istrue(r->contentlength < 2000);
+
+    eqint(200, request("GET /text HTTP/1.1\r\n"
+                "Accept-Encoding: deflate\r\n\r\n"));
+    eqstr("deflate", chttp_headerset_get(&r->headers, "Content-Encoding"));
+    istrue(r->contentlength < 2000);
+
+    /* HEAD is negotiated like the GET, without the content */
+    eqint(200, request("GET /text HTTP/1.1\r\n"
+                "Accept-Encoding: gzip\r\n\r\n"));
+    length = r->contentlength;
+    eqint(200, request("HEAD /text HTTP/1.1\r\n"
+                "Accept-Encoding: gzip\r\n\r\n"));
+    eqstr("gzip", chttp_headerset_get(&r->headers, "Content-Encoding"));
+    eqstr("Accept-Encoding", chttp_headerset_get(&r->headers, "Vary"));
+    eqint(length, r->contentlength);
+
+    eqint(200, request("HEAD /text HTTP/1.1\r\n\r\n"));
+    isnull(chttp_headerset_get(&r->headers, "Content-Encoding"));
+    eqint(2000, r->contentlength);
+
+    /* does not fit, streamed using the chunked encoding */
+    eqint(200, request("GET /large HTTP/1.1\r\n"
+                "Accept-Encoding: gzip\r\n\r\n"));
+    eqstr("gzip", chttp_headerset_get(&r->headers, "Content-Encoding"));
+    eqint(CHTTP_TE_CHUNKED, r->transferencoding);
+    eqint(LARGE, _inflate(content, 8192, 16 + MAX_WBITS));
+    eqint(0, memcmp(_text, _plain, LARGE));
+
+    /* the content type is not allowed */
+    config.compression_types = types;
+    eqint(200, request("GET /text HTTP/1.1\r\n"
+                "Accept-Encoding: gzip\r\n\r\n"));
+    isnull(chttp_headerset_get(&r->headers, "Content-Encoding"));
+    isnull(chttp_headerset_get(&r->headers, "Vary"));
+
+    serverfixture_teardown();
+}
+
+
+static void
+test_compress_stream() {
+    struct carrot_server_config config = carrot_server_defaultconfig;
+    struct chttp_response *r;
+
+    config.compression_level = 6;
+    serverconfig(&config);
+    r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_GET, "/text", _streamA, "text/plain");
+    route(CARROT_METHOD_GET, "/png", _streamA, "image/png");
+
+    eqint(200, request("GET /text HTTP/1.1\r\n"
+                "Accept-Encoding: gzip\r\n\r\n"));
+    eqint(CHTTP_TE_CHUNKED, r->transferencoding);
+    eqstr("gzip", chttp_headerset_get(&r->headers, "Content-Encoding"));
+    eqint(2000, _inflate(content, 8192, 16 + MAX_WBITS));
+    eqint(0, memcmp(_text, _plain, 2000));
+
+    /* not compressible */
+    eqint(200, request("GET /png HTTP/1.1\r\n"
+                "Accept-Encoding: gzip\r\n\r\n"));
+    eqint(CHTTP_TE_CHUNKED, r->transferencoding);
+    isnull(chttp_headerset_get(&r->headers, "Content-Encoding"));
+    isnull(chttp_headerset_get(&r->headers, "Vary"));
+    eqint(0, memcmp(_text, content, 2000));
+
+    serverfixture_teardown();
+}
+
+
+int
+main() {
+    size_t i;
+
+    for (i = 0; i < LARGE; i++) {
+        _text[i] = 'a' + (i * 7 % 26);
+    }
+
+    test_compress_negotiate();
+    test_compress_pool();
+    test_compress_response();
+    test_compress_stream();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <string.h>
+
+/* thirdparty */
+#include <cutest.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* local private */
+#include "router.h"
+
+/* test private */
+#include "tests/fixtures.h"
+
+
+/* generated from the routes.def */
+extern const struct carrot_dispatcher testdispatcher;
+
+
+int
+routes_listA(struct carrot_connection *c, void *ptr) {
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "list", -1, 0));
+    return 0;
+}
+
+
+int
+routes_createA(struct carrot_connection *c, void *ptr) {
+    ASSRT(0 < carrot_server_responseA(c, 201, NULL, "create", -1, 0));
+    return 0;
+}
+
+
+int
+routes_deleteA(struct carrot_connection *c, void *ptr) {
+    ASSRT(0 < carrot_server_responseA(c, 204, NULL, "", -1, 0));
+    return 0;
+}
+
+
+static int
+_itemA(struct carrot_connection *c, void *ptr) {
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "item", -1, 0));
+    return 0;
+}
+
+
+static void
+test_dispatcher_find() {
+    struct route *r;
+    const char *allow;
+    struct router_params params;
+    struct router router = {
+        .root = NULL,
+    };
+    const struct carrot_dispatcher *d = &testdispatcher;
+
+    eqint(38, d->count);
+    eqint(-1, d->find(CARROT_METHOD_GET, "/api/v1/foo", &allow));
+    eqint(-1, d->find(CARROT_METHOD_GET, "/api/v1/user", &allow));
+    eqint(-1, d->find(CARROT_METHOD_GET, "", &allow));
+
+    /* method not allowed */
+    allow = NULL;
+    eqint(-1, d->find(CARROT_METHOD_PUT, "/api/v1/users", &allow));
+    eqstr("Allow: GET, HEAD, POST, DELETE\r\n", allow);
+
+    eqint(0, router_dispatcher(&router, d));
+    r = router_find(&router, CARROT_METHOD_POST, "/api/v1/orders", &params,
+            &allow);
+    isnotnull(r);
+    istrue(r->handler == routes_createA);
+    eqint(CARROT_METHOD_POST, r->methods);
+
+    r = router_find(&router, CARROT_METHOD_GET, "/health", &params, &allow);
+    isnotnull(r);
+    istrue(r->handler == routes_listA);
+
+    /* automatic HEAD */
+    r = router_find(&router, CARROT_METHOD_HEAD, "/health", &params, &allow);
+    isnotnull(r);
+    istrue(r->handler == routes_listA);
+
+    /* the trie is the fallback */
+    isnull(router_find(&router, CARROT_METHOD_GET, "/api/v1/users/42",
+                &params, &allow));
+    isnotnull(router_append(&router, CARROT_METHOD_GET, "/api/v1/users/:id",
+                _itemA, NULL));
+    r = router_find(&router, CARROT_METHOD_GET, "/api/v1/users/42", &params,
+            &allow);
+    isnotnull(r);
+    istrue(r->handler == _itemA);
+    eqint(1, params.count);
+
+    router_deinit(&router);
+}
+
+
+static void
+test_dispatcher_server() {
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    eqint(0, dispatcher(&testdispatcher));
+    eqint(0, route(CARROT_METHOD_GET, "/api/v1/users/:id", _itemA, NULL));
+
+    eqint(200, request("GET /api/v1/users HTTP/1.1\r\n\r\n"));
+    eqstr("4", chttp_headerset_get(&r->headers, "Content-Length"));
+    eqint(201, request("POST /api/v1/tags HTTP/1.1\r\n\r\n"));
+    eqint(200, request("GET /api/v1/users/42 HTTP/1.1\r\n\r\n"));
+    eqint(404, request("GET /api/v2/users HTTP/1.1\r\n\r\n"));
+    eqint(405, request("PATCH /api/v1/tags HTTP/1.1\r\n\r\n"));
+    eqstr("GET, HEAD, POST, DELETE",
+            chttp_headerset_get(&r->headers, "Allow"));
+
+    serverfixture_teardown();
+}
+
+
+int
+main() {
+    test_dispatcher_find();
+    test_dispatcher_server();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+/* thirdparty */
+#include <cutest.h>
+
+/* local private */
+#include "encoding.h"
+
+
+static void
+test_encoding_accepts() {
+    isfalse(encoding_accepts(NULL, "gzip"));
+    isfalse(encoding_accepts("", "gzip"));
+    istrue(encoding_accepts("gzip", "gzip"));
+    istrue(encoding_accepts("deflate, gzip", "gzip"));
+    istrue(encoding_accepts("deflate,gzip;q=0.5", "gzip"));
+    istrue(encoding_accepts("GZip", "gzip"));
+    isfalse(encoding_accepts("deflate, br", "gzip"));
+    isfalse(encoding_accepts("gzip;q=0", "gzip"));
+    isfalse(encoding_accepts("gzip;q=0.000", "gzip"));
+    isfalse(encoding_accepts("x-gzip2", "gzip"));
+    istrue(encoding_accepts("*", "gzip"));
+    isfalse(encoding_accepts("*;q=0", "gzip"));
+    isfalse(encoding_accepts("gzip;q=0, *", "gzip"));
+}
+
+
+static void
+test_encoding_compressible() {
+    istrue(encoding_compressible("text/html"));
+    istrue(encoding_compressible("text/css; charset=utf-8"));
+    istrue(encoding_compressible("application/javascript"));
+    istrue(encoding_compressible("application/json"));
+    istrue(encoding_compressible("image/svg+xml"));
+    isfalse(encoding_compressible("image/png"));
+    isfalse(encoding_compressible("application/octet-stream"));
+    isfalse(encoding_compressible(NULL));
+}
+
+
+static void
+test_encoding_hastoken() {
+    isfalse(encoding_hastoken(NULL, "close"));
+    isfalse(encoding_hastoken("", "close"));
+    istrue(encoding_hastoken("close", "close"));
+    istrue(encoding_hastoken("Close", "close"));
+    istrue(encoding_hastoken("close, TE", "close"));
+    istrue(encoding_hastoken("TE,close", "close"));
+    istrue(encoding_hastoken("keep-alive , Upgrade", "keep-alive"));
+    istrue(encoding_hastoken("Upgrade,\tkeep-alive", "keep-alive"));
+    isfalse(encoding_hastoken("closed", "close"));
+    isfalse(encoding_hastoken("x-close, keep", "close"));
+}
+
+
+int
+main() {
+    test_encoding_accepts();
+    test_encoding_compressible();
+    test_encoding_hastoken();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* thirdparty */
+#include <cutest.h>
+
+/* local private */
+#include "static.h"
+#include "fdcache.h"
+
+
+static char _root[] = "/tmp/carrot-fdcache-XXXXXX";
+
+
+static void
+_write(const char *name, const char *content) {
+    FILE *f;
+    char path[128];
+
+    snprintf(path, sizeof(path), "%s/%s", _root, name);
+    f = fopen(path, "w");
+    fputs(content, f);
+    fclose(f);
+}
+
+
+static void
+test_fdcache_hit() {
+    struct static_dir *d = static_dir_new("/", _root);
+    struct fdcache *fc = fdcache_new(4, 60000);
+    struct fdentry *e1;
+    struct fdentry *e2;
+
+    isnotnull(d);
+    isnotnull(fc);
+
+    e1 = fdcache_open(fc, d, "a.txt");
+    isnotnull(e1);
+    eqint(3, e1->st.st_size);
+    eqstr("text/plain; charset=utf-8", e1->type);
+    fdcache_release(fc, e1);
+
+    e2 = fdcache_open(fc, d, "a.txt");
+    istrue(e1 == e2);
+    eqint(1, fc->count);
+    fdcache_release(fc, e2);
+
+    isnull(fdcache_open(fc, d, "notexists.txt"));
+    isnull(fdcache_open(fc, d, "."));
+    eqint(1, fc->count);
+
+    fdcache_free(fc);
+    static_dir_free(d);
+}
+
+
+static void
+test_fdcache_limit() {
+    struct static_dir *d = static_dir_new("/", _root);
+    struct fdcache *fc = fdcache_new(1, 60000);
+    struct fdentry *e1;
+    struct fdentry *e2;
+
+    /* the entry in use is not evicted, the new one is not cached */
+    e1 = fdcache_open(fc, d, "a.txt");
+    e2 = fdcache_open(fc, d, "b.txt");
+    isnotnull(e1);
+    isnotnull(e2);
+    istrue(e1->linked);
+    isfalse(e2->linked);
+    eqint(1, fc->count);
+    fdcache_release(fc, e2);
+
+    /* idle entries are evicted */
+    fdcache_release(fc, e1);
+    e2 = fdcache_open(fc, d, "b.txt");
+    istrue(e2->linked);
+    eqint(1, fc->count);
+    fdcache_release(fc, e2);
+
+    eqint(1, fdcache_shrink(fc, 10));
+    eqint(0, fc->count);
+
+    fdcache_free(fc);
+    static_dir_free(d);
+}
+
+
+static void
+test_fdcache_revalidate() {
+    struct static_dir *d = static_dir_new("/", _root);
+    struct fdcache *fc = fdcache_new(4, 0);
+    struct fdentry *e1;
+    struct fdentry *e2;
+
+    e1 = fdcache_open(fc, d, "c.txt");
+    eqint(3, e1->st.st_size);
+
+    /* replaced while in use */
+    _write("c.txt", "foobar");
+    e2 = fdcache_open(fc, d, "c.txt");
+    istrue(e1 != e2);
+    eqint(6, e2->st.st_size);
+    eqint(1, fc->count);
+    fdcache_release(fc, e1);
+    fdcache_release(fc, e2);
+
+    fdcache_free(fc);
+    static_dir_free(d);
+}
+
+
+int
+main() {
+    if (mkdtemp(_root) == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    _write("a.txt", "foo");
+    _write("b.txt", "bar");
+    _write("c.txt", "baz");
+
+    test_fdcache_hit();
+    test_fdcache_limit();
+    test_fdcache_revalidate();
+    return EXIT_SUCCESS;
+}
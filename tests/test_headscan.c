@@ -0,0 +1,144 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <string.h>
+
+/* thirdparty */
+#include <cutest.h>
+
+/* local private */
+#include "headscan.h"
+
+
+#define HEADER \
+    "GET /foo HTTP/1.1\r\n" \
+    "Host: example.com\r\n" \
+    "Cookie: a=b; c=d\r\n" \
+    "\r\n" \
+    "body"
+#define HEADERLEN (sizeof(HEADER) - 1 - 8)
+
+
+static enum headscan_status
+_feed(const char *header, size_t maxsize, size_t *headerlen) {
+    struct carrot_headerscan s;
+
+    headscan_reset(&s);
+    return headscan_feed(&s, header, strlen(header), maxsize, headerlen);
+}
+
+
+static void
+test_headscan_complete() {
+    size_t headerlen = 0;
+
+    eqint(HEADSCAN_DONE, _feed(HEADER, 0, &headerlen));
+    eqint(HEADERLEN, headerlen);
+    eqint(0, memcmp(HEADER + headerlen, "\r\n\r\n", 4));
+
+    eqint(HEADSCAN_DONE, _feed("GET / HTTP/1.1\r\n\r\n", 0, &headerlen));
+    eqint(14, headerlen);
+
+    eqint(HEADSCAN_MORE, _feed("GET / HTTP/1.1\r\n", 0, &headerlen));
+    eqint(HEADSCAN_MORE, _feed("GET / HTTP/1.1\r\nHost: a\r\n\r", 0,
+                &headerlen));
+
+    /* HTAB is allowed in the field values */
+    eqint(HEADSCAN_DONE, _feed("GET / HTTP/1.1\r\nfoo:\ta\tb\r\n\r\n", 0,
+                &headerlen));
+    eqint(24, headerlen);
+}
+
+
+static void
+test_headscan_incremental() {
+    struct carrot_headerscan s;
+    size_t headerlen = 0;
+    size_t len;
+
+    /* byte by byte */
+    headscan_reset(&s);
+    for (len = 0; len <= (HEADERLEN + 3); len++) {
+        eqint(HEADSCAN_MORE, headscan_feed(&s, HEADER, len, 0, &headerlen));
+    }
+    eqint(HEADSCAN_DONE, headscan_feed(&s, HEADER, len, 0, &headerlen));
+    eqint(HEADERLEN, headerlen);
+
+    /* the validated lines are not visited again */
+    headscan_reset(&s);
+    eqint(HEADSCAN_MORE, headscan_feed(&s, HEADER, 25, 0, &headerlen));
+    eqint(1, s.lines);
+    eqint(19, s.line);
+    eqint(25, s.scanned);
+}
+
+
+static void
+test_headscan_malformed() {
+    size_t headerlen;
+
+    eqint(HEADSCAN_MALFORMED, _feed("\r\n\r\n", 0, &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET / HTTP/1.1\n", 0, &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET /\x7f HTTP/1.1\r\n", 0,
+                &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET /\t HTTP/1.1\r\n", 0, &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET / HTTP/1.1\r\nfoo: a\001b\r\n", 0,
+                &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET / HTTP/1.1\r\n\n", 0, &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET / HTTP/1.1\r\nfoo\r\n", 0,
+                &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET / HTTP/1.1\r\n: foo\r\n", 0,
+                &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET / HTTP/1.1\r\nfoo bar: baz\r\n", 0,
+                &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET / HTTP/1.1\r\nfoo: a\r\n b\r\n", 0,
+                &headerlen));
+    eqint(HEADSCAN_MALFORMED, _feed("GET / HTTP/1.1\r\nfoo: a\rb\r\n", 0,
+                &headerlen));
+
+    /* a malformed line is reported before the end of the header */
+    eqint(HEADSCAN_MALFORMED, _feed("GET / HTTP/1.1\r\nfoo\r\nbar: ", 0,
+                &headerlen));
+}
+
+
+static void
+test_headscan_toolarge() {
+    size_t headerlen;
+
+    eqint(HEADSCAN_DONE, _feed(HEADER, HEADERLEN + 4, &headerlen));
+    eqint(HEADSCAN_TOOLARGE, _feed(HEADER, HEADERLEN + 3, &headerlen));
+    eqint(HEADSCAN_TOOLARGE, _feed(HEADER, 20, &headerlen));
+
+    /* without waiting for the end of the line */
+    eqint(HEADSCAN_TOOLARGE, _feed("GET / HTTP/1.1\r\nfoo: bar", 20,
+                &headerlen));
+    eqint(HEADSCAN_MORE, _feed("GET / HTTP/1.1\r\nfoo: ba", 24,
+                &headerlen));
+}
+
+
+int
+main() {
+    test_headscan_complete();
+    test_headscan_incremental();
+    test_headscan_malformed();
+    test_headscan_toolarge();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <pthread.h>
+
+/* posix */
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/* thirdparty */
+#include <cutest.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* local private */
+#include "offload.h"
+
+/* test private */
+#include "tests/fixtures.h"
+
+
+static int _pipe[2];
+
+
+static int
+_block(void *arg) {
+    char c;
+
+    if (read(_pipe[0], &c, 1) != 1) {
+        return -1;
+    }
+
+    return c;
+}
+
+
+static int
+_sum(void *arg) {
+    int *n = arg;
+    int i;
+    int sum = 0;
+
+    for (i = 1; i <= *n; i++) {
+        sum += i;
+    }
+
+    *n = sum;
+    return 0;
+}
+
+
+static int
+_indexA(struct carrot_connection *c, void *ptr) {
+    int n = 100;
+
+    ASSRT(0 == carrot_server_offloadA(c, _sum, &n));
+    ASSRT(5050 == n);
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "Ok", -1, 0));
+    return 0;
+}
+
+
+static void
+test_offload_queue() {
+    struct offload *o;
+    struct offload_job a = {.fn = _block};
+    struct offload_job b = {.fn = _block};
+    struct offload_job c = {.fn = _block};
+    eventfd_t val;
+    unsigned long running;
+
+    eqint(0, pipe(_pipe));
+    a.fd = eventfd(0, EFD_CLOEXEC);
+    b.fd = eventfd(0, EFD_CLOEXEC);
+
+    /* one running and one waiting, the next one is rejected */
+    o = offload_new(1, 1);
+    isnotnull(o);
+    eqint(0, offload_submit(o, &a));
+    for (;;) {
+        pthread_mutex_lock(&o->lock);
+        running = o->running;
+        pthread_mutex_unlock(&o->lock);
+        if (running) {
+            break;
+        }
+        usleep(1000);
+    }
+    eqint(0, offload_submit(o, &b));
+    eqint(-1, offload_submit(o, &c));
+    eqint(1, o->queued);
+    eqint(1, o->rejected);
+
+    /* only the waiting ones are taken back */
+    eqint(-1, offload_cancel(o, &a));
+    eqint(0, offload_cancel(o, &b));
+    eqint(-1, offload_cancel(o, &b));
+    eqint(0, o->queued);
+    isnull(o->head);
+    isnull(o->tail);
+    eqint(0, offload_submit(o, &b));
+
+    eqint(2, write(_pipe[1], "ab", 2));
+    eqint(0, eventfd_read(a.fd, &val));
+    eqint(0, eventfd_read(b.fd, &val));
+    eqint('a', a.status);
+    eqint('b', b.status);
+    eqint(1, a.done);
+    eqint(1, b.done);
+    eqint(2, o->completed);
+    eqint(0, o->queued);
+
+    offload_free(o);
+    close(a.fd);
+    close(b.fd);
+    close(_pipe[0]);
+    close(_pipe[1]);
+}
+
+
+static void
+test_offload_request() {
+    struct carrot_server_config config = carrot_server_defaultconfig;
+    struct chttp_response *r;
+
+    /* in place */
+    r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_GET, "/", _indexA, NULL);
+    eqint(200, request("GET / HTTP/1.1\r\n\r\n"));
+    serverfixture_teardown();
+
+    /* thread pool */
+    config.offload_threads = 2;
+    serverconfig(&config);
+    r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_GET, "/", _indexA, NULL);
+    eqint(200, request("GET / HTTP/1.1\r\n\r\n"));
+    eqint(200, request("GET / HTTP/1.1\r\n\r\n"));
+    serverfixture_teardown();
+}
+
+
+int
+main() {
+    test_offload_queue();
+    test_offload_request();
+    return EXIT_SUCCESS;
+}
@@ -17,6 +17,8 @@
  *  Author: Vahid Mardani <vahid.mardani@gmail.com>
  */
 /* standard */
+#include <string.h>
+
 /* thirdparty */
 #include <cutest.h>
 
@@ -52,7 +54,7 @@ static void
 test_request_headers() {
     struct chttp_response *r = serverfixture_setup(1);
     isnotnull(r);
-    route("GET", "/", _indexA, NULL);
+    route(CARROT_METHOD_GET, "/", _indexA, NULL);
 
     eqint(200, request("GET / HTTP/1.1\r\n"
                 "x-foo: bar\r\n\r\n"));
@@ -68,6 +70,75 @@ test_request_headers() {
 }
 
 
+static int _hits;
+
+
+static int
+_hitA(struct carrot_connection *c, void *ptr) {
+    _hits++;
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "Hit", -1, 0));
+    return 0;
+}
+
+
+static void
+test_request_pipelining() {
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_GET, "/", _hitA, NULL);
+    route(CARROT_METHOD_POST, "/", _hitA, NULL);
+
+    /* both responses are sent using a single write */
+    _hits = 0;
+    eqint(200, request("GET / HTTP/1.1\r\n\r\n"
+                "GET / HTTP/1.1\r\n\r\n"));
+    eqint(2, _hits);
+
+    /* the unread body is discarded before the next request */
+    _hits = 0;
+    eqint(200, request("POST / HTTP/1.1\r\n"
+                "Content-Length: 3\r\n\r\nfoo"
+                "GET / HTTP/1.1\r\n\r\n"));
+    eqint(2, _hits);
+
+    serverfixture_teardown();
+}
+
+
+static void
+test_request_prerendered() {
+    const char *headers[] = {
+        "Cache-Control: no-store",
+        "X-Frame-Options: DENY",
+        NULL,
+    };
+    struct carrot_route_options options = {
+        .headers = headers,
+    };
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_GET, "/", _hitA, NULL);
+    routex(CARROT_METHOD_GET, "/nocache", _hitA, NULL, &options);
+
+    eqint(200, request("GET / HTTP/1.1\r\n\r\n"));
+    isnotnull(chttp_headerset_get(&r->headers, "Date"));
+    isnull(chttp_headerset_get(&r->headers, "Cache-Control"));
+
+    eqint(200, request("GET /nocache HTTP/1.1\r\n\r\n"));
+    isnotnull(chttp_headerset_get(&r->headers, "Date"));
+    eqstr("no-store", chttp_headerset_get(&r->headers, "Cache-Control"));
+    eqstr("DENY", chttp_headerset_get(&r->headers, "X-Frame-Options"));
+    eqstr("3", chttp_headerset_get(&r->headers, "Content-Length"));
+
+    /* the route headers are not sent with the 404 responses */
+    eqint(404, request("GET /notfound HTTP/1.1\r\n\r\n"));
+    isnotnull(chttp_headerset_get(&r->headers, "Date"));
+    isnull(chttp_headerset_get(&r->headers, "Cache-Control"));
+
+    serverfixture_teardown();
+}
+
+
 static void
 test_request_startline() {
     struct chttp_response *r = serverfixture_setup(1);
@@ -83,9 +154,94 @@ test_request_startline() {
 }
 
 
+static void
+test_request_headerlines() {
+    struct carrot_server_config config = carrot_server_defaultconfig;
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+
+    /* bare LF, missing colon, obsolete line folding and control chars */
+    eqint(400, request("GET / HTTP/1.1\nHost: foo\r\n\r\n"));
+    eqint(400, request("GET / HTTP/1.1\r\nHost foo\r\n\r\n"));
+    eqint(400, request("GET / HTTP/1.1\r\nHost : foo\r\n\r\n"));
+    eqint(400, request("GET / HTTP/1.1\r\nX-Foo: a\r\n b\r\n\r\n"));
+    eqint(400, request("GET / HTTP/1.1\r\nX-Foo: a\x01b\r\n\r\n"));
+    eqint(400, request("\r\n\r\n"));
+    eqint(404, request("GET / HTTP/1.1\r\nX-Foo: a\tb\r\n\r\n"));
+
+    /* oversized header */
+    config.header_maxsize = 64;
+    serverconfig(&config);
+    eqint(404, request("GET / HTTP/1.1\r\nX-Foo: %032d\r\n\r\n", 0));
+    eqint(431, request("GET / HTTP/1.1\r\nX-Foo: %064d\r\n\r\n", 0));
+    eqint(431, r->status);
+
+    /* the limit is applied before the end of the header */
+    eqint(431, request("GET / HTTP/1.1\r\nX-Foo: %064d", 0));
+    serverfixture_teardown();
+}
+
+
+static int
+_okA(struct carrot_connection *c, void *ptr) {
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, "Ok", -1, 0));
+    return 0;
+}
+
+
+static void
+test_request_routeheadermax() {
+    struct carrot_route_options options = {
+        .header_maxsize = 64,
+    };
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    route(CARROT_METHOD_GET, "/", _okA, NULL);
+    routex(CARROT_METHOD_GET, "/strict", _okA, NULL, &options);
+
+    eqint(200, request("GET / HTTP/1.1\r\nX-Foo: %064d\r\n\r\n", 0));
+    eqint(200, request("GET /strict HTTP/1.1\r\nX-Foo: %016d\r\n\r\n",
+                0));
+    eqint(431, request("GET /strict HTTP/1.1\r\nX-Foo: %064d\r\n\r\n",
+                0));
+    serverfixture_teardown();
+}
+
+
+static void
+test_request_buffergrowth() {
+    struct carrot_server_config config = carrot_server_defaultconfig;
+    struct chttp_response *r;
+    char value[6000];
+
+    memset(value, 'a', sizeof(value) - 1);
+    value[sizeof(value) - 1] = 0;
+
+    /* the header does not fit in the initial single page ring */
+    config.header_maxsize = 0;
+    config.connectionbuffer_mempages = 1;
+    config.connectionbuffer_maxpages = 4;
+    config.requestbuffer_mempages = 4;
+    serverconfig(&config);
+    r = serverfixture_setup(1);
+    isnotnull(r);
+    eqint(404, request("GET / HTTP/1.1\r\nX-Foo: %s\r\n\r\n", value));
+
+    /* unable to grow */
+    config.connectionbuffer_maxpages = 1;
+    eqint(431, request("GET / HTTP/1.1\r\nX-Foo: %s\r\n\r\n", value));
+    serverfixture_teardown();
+}
+
+
 int
 main() {
     test_request_headers();
+    test_request_pipelining();
+    test_request_prerendered();
     test_request_startline();
+    test_request_headerlines();
+    test_request_buffergrowth();
+    test_request_routeheadermax();
     return EXIT_SUCCESS;
 }
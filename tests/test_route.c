@@ -17,6 +17,8 @@
  *  Author: Vahid Mardani <vahid.mardani@gmail.com>
  */
 /* standard */
+#include <string.h>
+
 /* thirdparty */
 #include <cutest.h>
 
@@ -31,26 +33,215 @@
 #include "tests/fixtures.h"
 
 
+#define GET CARROT_METHOD_GET
+#define HEAD CARROT_METHOD_HEAD
+#define POST CARROT_METHOD_POST
+#define DELETE CARROT_METHOD_DELETE
+
+
+static struct router_params _params;
+static const char *_allow;
+
+
+static int
+_handler(struct carrot_connection *c, void *ptr) {
+    return 0;
+}
+
+
+static struct route *
+_find(struct router *rt, enum carrot_method method, const char *path) {
+    return router_find(rt, method, path, &_params, &_allow);
+}
+
+
+#define PARAM(i, n, v) do { \
+    eqstr(n, _params.list[i].name); \
+    eqint(strlen(v), _params.list[i].len); \
+    eqint(0, strncmp(v, _params.list[i].value, _params.list[i].len)); \
+} while (0)
+
+
 static void
 test_route_find() {
     struct route *r;
     struct router router = {
-        .count = 0,
+        .root = NULL,
+    };
+
+    isnotnull(router_append(&router, GET, "/foo", _handler, "foo"));
+    isnotnull(router_append(&router, POST, "/foo", _handler, "postfoo"));
+    isnotnull(router_append(&router, GET, "/foobar", _handler, "foobar"));
+    isnotnull(router_append(&router, GET, "/fox", _handler, "fox"));
+    isnotnull(router_append(&router, GET, "/", _handler, "index"));
+
+    r = _find(&router, GET, "/foo");
+    isnotnull(r);
+    eqint(GET, r->methods);
+    eqstr("foo", r->ptr);
+    eqint(0, _params.count);
+
+    eqstr("postfoo", _find(&router, POST, "/foo")->ptr);
+    eqstr("foobar", _find(&router, GET, "/foobar")->ptr);
+    eqstr("fox", _find(&router, GET, "/fox")->ptr);
+    eqstr("index", _find(&router, GET, "/")->ptr);
+
+    isnull(_find(&router, GET, "/bar"));
+    isnull(_allow);
+    isnull(_find(&router, GET, "/fo"));
+    isnull(_find(&router, GET, "/foob"));
+    isnull(_find(&router, GET, ""));
+
+    router_deinit(&router);
+    isnull(router.root);
+}
+
+
+static void
+test_route_methods() {
+    struct route *r;
+    struct router router = {
+        .root = NULL,
+    };
+
+    isnotnull(router_append(&router, GET | POST, "/foo", _handler, "foo"));
+    isnotnull(router_append(&router, DELETE, "/foo", _handler, "delete"));
+    isnotnull(router_append(&router, HEAD, "/bar", _handler, "headbar"));
+    isnotnull(router_append(&router, GET, "/bar", _handler, "bar"));
+    isnotnull(router_append(&router, CARROT_METHOD_EXTENSION, "/ext",
+                _handler, "ext"));
+
+    eqstr("foo", _find(&router, GET, "/foo")->ptr);
+    eqstr("foo", _find(&router, POST, "/foo")->ptr);
+    eqstr("delete", _find(&router, DELETE, "/foo")->ptr);
+    eqstr("ext", _find(&router, CARROT_METHOD_EXTENSION, "/ext")->ptr);
+
+    /* automatic HEAD, unless there is a dedicated handler */
+    r = _find(&router, HEAD, "/foo");
+    isnotnull(r);
+    eqstr("foo", r->ptr);
+    eqstr("headbar", _find(&router, HEAD, "/bar")->ptr);
+
+    /* method not allowed */
+    isnull(_find(&router, CARROT_METHOD_PUT, "/foo"));
+    eqstr("Allow: GET, HEAD, POST, DELETE\r\n", _allow);
+    isnull(_find(&router, POST, "/bar"));
+    eqstr("Allow: GET, HEAD\r\n", _allow);
+    isnull(_find(&router, GET, "/ext"));
+    eqstr("Allow: \r\n", _allow);
+
+    router_deinit(&router);
+}
+
+
+static void
+test_route_params() {
+    struct route *r;
+    struct router router = {
+        .root = NULL,
     };
 
-    eqint(0, router_append(&router, "GET", "/foo", NULL, NULL));
+    isnotnull(router_append(&router, GET, "/users/:id", _handler, "user"));
+    isnotnull(router_append(&router, GET, "/users/me", _handler, "me"));
+    isnotnull(router_append(&router, GET, "/users/:id/posts/:post",
+                _handler, "post"));
+    isnotnull(router_append(&router, GET, "/static/*", _handler, "static"));
+    isnotnull(router_append(&router, GET, "/files/*path", _handler,
+                "files"));
+    isnotnull(router_append(&router, GET, "/a:b", _handler, "colon"));
+
+    /* conflicting parameter names */
+    isnull(router_append(&router, GET, "/users/:name", _handler, NULL));
+
+    /* the wildcard must be the last one */
+    isnull(router_append(&router, GET, "/x/*/y", _handler, NULL));
+
+    r = _find(&router, GET, "/users/42");
+    eqstr("user", r->ptr);
+    eqint(1, _params.count);
+    PARAM(0, "id", "42");
+
+    /* static segments have the priority */
+    r = _find(&router, GET, "/users/me");
+    eqstr("me", r->ptr);
+    eqint(0, _params.count);
+
+    r = _find(&router, GET, "/users/mex");
+    eqstr("user", r->ptr);
+    PARAM(0, "id", "mex");
+
+    r = _find(&router, GET, "/users/42/posts/7");
+    eqstr("post", r->ptr);
+    eqint(2, _params.count);
+    PARAM(0, "id", "42");
+    PARAM(1, "post", "7");
+
+    isnull(_find(&router, GET, "/users/"));
+    isnull(_find(&router, GET, "/users/42/posts"));
+
+    /* the method is not allowed for the parameterized path */
+    isnull(_find(&router, POST, "/users/42"));
+    eqstr("Allow: GET, HEAD\r\n", _allow);
 
-    r = router_find(&router, "GET", "/foo");
+    r = _find(&router, GET, "/static/css/main.css");
+    eqstr("static", r->ptr);
+    PARAM(0, "*", "css/main.css");
+
+    r = _find(&router, GET, "/static/");
+    eqstr("static", r->ptr);
+    PARAM(0, "*", "");
+
+    r = _find(&router, GET, "/files/a/b");
+    eqstr("files", r->ptr);
+    PARAM(0, "path", "a/b");
+
+    r = _find(&router, GET, "/a:b");
+    eqstr("colon", r->ptr);
+    eqint(0, _params.count);
+
+    router_deinit(&router);
+}
+
+
+static int
+_userA(struct carrot_connection *c, void *ptr) {
+    size_t len;
+    const char *id = carrot_server_param(c, "id", &len);
+
+    ASSRT(id);
+    ASSRT(NULL == carrot_server_param(c, "notexists", NULL));
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, id, len, 0));
+    return 0;
+}
+
+
+static void
+test_route_server() {
+    struct chttp_response *r = serverfixture_setup(1);
     isnotnull(r);
-    eqstr("GET", r->verb);
-    eqstr("/foo", r->path);
+    eqint(0, route(GET, "/users/:id", _userA, NULL));
+
+    eqint(200, request("GET /users/42 HTTP/1.1\r\n\r\n"));
+    eqstr("2", chttp_headerset_get(&r->headers, "Content-Length"));
+    eqint(404, request("GET /users HTTP/1.1\r\n\r\n"));
+
+    /* automatic HEAD */
+    eqint(200, request("HEAD /users/42 HTTP/1.1\r\n\r\n"));
+    eqstr("2", chttp_headerset_get(&r->headers, "Content-Length"));
+
+    /* method not allowed */
+    eqint(405, request("DELETE /users/42 HTTP/1.1\r\n\r\n"));
+    eqstr("GET, HEAD", chttp_headerset_get(&r->headers, "Allow"));
 
-    isnull(router_find(&router, "GET", "/bar"));
+    serverfixture_teardown();
 }
 
 
 int
 main() {
     test_route_find();
+    test_route_methods();
+    test_route_params();
+    test_route_server();
     return EXIT_SUCCESS;
 }
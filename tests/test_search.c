@@ -0,0 +1,168 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <string.h>
+
+/* thirdparty */
+#include <cutest.h>
+
+/* local private */
+#include "search.h"
+
+
+#define BUFFSIZE 256
+
+
+static ssize_t
+_expected(const char *buff, size_t len) {
+    const char *found = memmem(buff, len, "\r\n\r\n", 4);
+
+    return found? found - buff: -1;
+}
+
+
+static void
+_assert_all(const char *buff, size_t len) {
+    ssize_t expected = _expected(buff, len);
+
+    eqint(expected, search_crlfcrlf(buff, len));
+    eqint(expected, search_crlfcrlf_scalar(buff, len));
+#if defined(__x86_64__) || defined(__i386__)
+    eqint(expected, search_crlfcrlf_sse2(buff, len));
+    if (__builtin_cpu_supports("avx2")) {
+        eqint(expected, search_crlfcrlf_avx2(buff, len));
+    }
+#endif
+}
+
+
+static void
+test_search_offsets() {
+    char buff[BUFFSIZE];
+    size_t len;
+    size_t i;
+
+    /* terminator at every offset of every length, including the vector
+     * boundaries and the scalar tails */
+    for (len = 0; len <= BUFFSIZE; len++) {
+        memset(buff, 'a', BUFFSIZE);
+        _assert_all(buff, len);
+        for (i = 0; (i + 4) <= len; i++) {
+            memset(buff, 'a', BUFFSIZE);
+            memcpy(buff + i, "\r\n\r\n", 4);
+            _assert_all(buff, len);
+        }
+    }
+}
+
+
+static void
+test_search_partial() {
+    char buff[BUFFSIZE];
+    size_t i;
+
+    /* lots of false candidates */
+    for (i = 0; i < BUFFSIZE; i += 2) {
+        memcpy(buff + i, "\r\n", 2);
+    }
+    for (i = 2; i < BUFFSIZE; i += 4) {
+        buff[i] = 'x';
+    }
+    _assert_all(buff, BUFFSIZE);
+
+    memcpy(buff + 100, "\r\n\r\r\n\r\n", 7);
+    _assert_all(buff, BUFFSIZE);
+    eqint(103, search_crlfcrlf(buff, BUFFSIZE));
+
+    /* first of the two */
+    memcpy(buff + 40, "\n\r\n\r\n", 5);
+    _assert_all(buff, BUFFSIZE);
+    eqint(41, search_crlfcrlf(buff, BUFFSIZE));
+
+    /* cut at the end */
+    _assert_all(buff, 43);
+    eqint(-1, search_crlfcrlf(buff, 43));
+    _assert_all(buff, 44);
+    eqint(-1, search_crlfcrlf(buff, 44));
+    eqint(41, search_crlfcrlf(buff, 45));
+}
+
+
+static void
+_assert_ctl(const char *buff, size_t len, int tab, ssize_t expected) {
+    eqint(expected, search_ctl(buff, len, tab));
+    eqint(expected, search_ctl_scalar(buff, len, tab));
+#if defined(__x86_64__) || defined(__i386__)
+    eqint(expected, search_ctl_sse2(buff, len, tab));
+    if (__builtin_cpu_supports("avx2")) {
+        eqint(expected, search_ctl_avx2(buff, len, tab));
+    }
+#endif
+}
+
+
+static void
+test_search_ctl() {
+    char buff[BUFFSIZE];
+    size_t len;
+    size_t i;
+    int c;
+
+    /* every byte value at every offset of a few lengths around the vector
+     * boundaries, the rest is all the non-CTL bytes */
+    for (len = 1; len <= 72; len++) {
+        for (i = 0; i < len; i++) {
+            buff[i] = 0x20 + (i % 0x5f);
+        }
+        buff[len - 1] = 0x80 + len;
+        _assert_ctl(buff, len, 0, -1);
+        _assert_ctl(buff, len, 1, -1);
+
+        for (i = 0; i < len; i += 7) {
+            for (c = 0; c < 256; c++) {
+                buff[i] = c;
+                if ((c < 0x20) || (c == 0x7f)) {
+                    _assert_ctl(buff, len, 0, i);
+                    _assert_ctl(buff, len, 1, (c == '\t')? -1: (ssize_t)i);
+                }
+                else {
+                    _assert_ctl(buff, len, 0, -1);
+                    _assert_ctl(buff, len, 1, -1);
+                }
+            }
+            buff[i] = 'a';
+        }
+    }
+
+    /* the first one */
+    memset(buff, 'a', BUFFSIZE);
+    memcpy(buff + 40, "\t\r\n\x7f", 4);
+    _assert_ctl(buff, BUFFSIZE, 0, 40);
+    _assert_ctl(buff, BUFFSIZE, 1, 41);
+    _assert_ctl(buff + 43, BUFFSIZE - 43, 1, 0);
+}
+
+
+int
+main() {
+    test_search_offsets();
+    test_search_partial();
+    test_search_ctl();
+    return EXIT_SUCCESS;
+}
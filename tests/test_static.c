@@ -0,0 +1,266 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* thirdparty */
+#include <cutest.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* test private */
+#include "tests/fixtures.h"
+
+
+#define ASSETSIZE 4096
+
+
+static char _root[] = "/tmp/carrot-static-XXXXXX";
+static char _file[64];
+static char _escape[64];
+static const char *_assets[] = {"a.txt", "b.txt", "c.txt", NULL};
+
+
+/* write len copies of the character into the file of the root */
+static int
+_write(const char *name, char c, size_t len) {
+    char path[64];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/%s", _root, name);
+    f = fopen(path, "w");
+    ASSRT(f);
+    while (len--) {
+        fputc(c, f);
+    }
+    fclose(f);
+    return 0;
+}
+
+
+static void
+_unlink(const char *name) {
+    char path[64];
+
+    snprintf(path, sizeof(path), "%s/%s", _root, name);
+    unlink(path);
+}
+
+
+static int
+_setup() {
+    FILE *f;
+    const char **name;
+
+    ASSRT(mkdtemp(_root));
+    snprintf(_file, sizeof(_file), "%s/hello.txt", _root);
+    f = fopen(_file, "w");
+    ASSRT(f);
+    fputs("Hello World", f);
+    fclose(f);
+
+    /* compressible, the asset cache keeps a gzip variant of them */
+    for (name = _assets; *name; name++) {
+        ERR(_write(*name, 'a', ASSETSIZE));
+    }
+
+    /* a symlink pointing outside the root */
+    snprintf(_escape, sizeof(_escape), "%s/passwd", _root);
+    ASSRT(symlink("/etc/passwd", _escape) == 0);
+    return 0;
+}
+
+
+static void
+test_static_get() {
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    eqint(0, staticdir("/static", _root));
+
+    eqint(200, request("GET /static/hello.txt HTTP/1.1\r\n\r\n"));
+    eqstr("11", chttp_headerset_get(&r->headers, "Content-Length"));
+    eqstr("text/plain; charset=utf-8",
+            chttp_headerset_get(&r->headers, "Content-Type"));
+    eqstr("bytes", chttp_headerset_get(&r->headers, "Accept-Ranges"));
+    isnotnull(chttp_headerset_get(&r->headers, "Last-Modified"));
+
+    eqint(200, request("HEAD /static/hello.txt HTTP/1.1\r\n\r\n"));
+    eqstr("11", chttp_headerset_get(&r->headers, "Content-Length"));
+
+    eqint(404, request("GET /static/notexists.txt HTTP/1.1\r\n\r\n"));
+    eqint(403, request("GET /static/../etc/passwd HTTP/1.1\r\n\r\n"));
+    eqint(404, request("GET /static/passwd HTTP/1.1\r\n\r\n"));
+
+    serverfixture_teardown();
+}
+
+
+static void
+test_static_range() {
+    struct chttp_response *r = serverfixture_setup(1);
+    isnotnull(r);
+    eqint(0, staticdir("/static", _root));
+
+    eqint(206, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "Range: bytes=0-4\r\n\r\n"));
+    eqstr("5", chttp_headerset_get(&r->headers, "Content-Length"));
+    eqstr("bytes 0-4/11", chttp_headerset_get(&r->headers, "Content-Range"));
+
+    eqint(206, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "Range: bytes=-5\r\n\r\n"));
+    eqstr("bytes 6-10/11",
+            chttp_headerset_get(&r->headers, "Content-Range"));
+
+    eqint(206, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "Range: bytes=0-1, 6-\r\n\r\n"));
+    isnotnull(chttp_headerset_get(&r->headers, "Content-Type"));
+
+    eqint(416, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "Range: bytes=20-\r\n\r\n"));
+    eqstr("bytes */11", chttp_headerset_get(&r->headers, "Content-Range"));
+
+    /* invalid ranges are ignored */
+    eqint(200, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "Range: bytes=5-1\r\n\r\n"));
+
+    serverfixture_teardown();
+}
+
+
+static void
+test_static_assetcache() {
+    char etag[32];
+    struct chttp_response *r;
+    struct carrot_server_config config = carrot_server_defaultconfig;
+
+    config.assetcache_size = 65536;
+    serverconfig(&config);
+    r = serverfixture_setup(1);
+    isnotnull(r);
+    eqint(0, staticdir("/static", _root));
+
+    /* loaded on the first request, then served from memory */
+    eqint(200, request("GET /static/hello.txt HTTP/1.1\r\n\r\n"));
+    isnotnull(chttp_headerset_get(&r->headers, "ETag"));
+    strncpy(etag, chttp_headerset_get(&r->headers, "ETag"), sizeof(etag) - 1);
+    etag[sizeof(etag) - 1] = 0;
+    eqint(200, request("GET /static/hello.txt HTTP/1.1\r\n\r\n"));
+    eqstr("11", chttp_headerset_get(&r->headers, "Content-Length"));
+    eqstr(etag, chttp_headerset_get(&r->headers, "ETag"));
+    isnotnull(chttp_headerset_get(&r->headers, "Last-Modified"));
+
+    /* validators */
+    eqint(304, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "If-None-Match: %s\r\n\r\n", etag));
+    eqstr(etag, chttp_headerset_get(&r->headers, "ETag"));
+    eqint(304, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "If-None-Match: \"foo\", %s\r\n\r\n", etag));
+    eqint(200, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "If-None-Match: \"foo\"\r\n\r\n"));
+    eqstr("11", chttp_headerset_get(&r->headers, "Content-Length"));
+
+    /* the gzip variant, only if it's smaller than the file */
+    eqint(200, request("GET /static/a.txt HTTP/1.1\r\n"
+                "Accept-Encoding: gzip\r\n\r\n"));
+    eqstr("gzip", chttp_headerset_get(&r->headers, "Content-Encoding"));
+    eqstr("Accept-Encoding", chttp_headerset_get(&r->headers, "Vary"));
+    istrue(atoi(chttp_headerset_get(&r->headers, "Content-Length")) <
+            ASSETSIZE);
+    eqint(200, request("GET /static/a.txt HTTP/1.1\r\n\r\n"));
+    isnull(chttp_headerset_get(&r->headers, "Content-Encoding"));
+    eqstr("4096", chttp_headerset_get(&r->headers, "Content-Length"));
+    eqint(200, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "Accept-Encoding: gzip\r\n\r\n"));
+    isnull(chttp_headerset_get(&r->headers, "Content-Encoding"));
+
+    /* the changed files are invalidated, and stale until notified */
+    eqint(0, _write("hello.txt", 'h', 13));
+    eqint(200, request("GET /static/hello.txt HTTP/1.1\r\n\r\n"));
+    eqstr("11", chttp_headerset_get(&r->headers, "Content-Length"));
+    eqint(0, staticnotify());
+    eqint(200, request("GET /static/hello.txt HTTP/1.1\r\n\r\n"));
+    eqstr("13", chttp_headerset_get(&r->headers, "Content-Length"));
+    isfalse(strcmp(etag, chttp_headerset_get(&r->headers, "ETag")) == 0);
+    eqint(200, request("GET /static/hello.txt HTTP/1.1\r\n"
+                "If-None-Match: %s\r\n\r\n", etag));
+
+    serverfixture_teardown();
+}
+
+
+static void
+test_static_assetcache_evict() {
+    struct chttp_response *r;
+    struct carrot_server_config config = carrot_server_defaultconfig;
+
+    /* room for two of the assets, including the headers and the gzip
+     * variants */
+    config.assetcache_size = ASSETSIZE * 3;
+    serverconfig(&config);
+    r = serverfixture_setup(1);
+    isnotnull(r);
+    eqint(0, staticdir("/static", _root));
+
+    /* b.txt is the least recently used one when c.txt is loaded */
+    eqint(200, request("GET /static/a.txt HTTP/1.1\r\n\r\n"));
+    eqint(200, request("GET /static/b.txt HTTP/1.1\r\n\r\n"));
+    eqint(200, request("GET /static/a.txt HTTP/1.1\r\n\r\n"));
+    eqint(200, request("GET /static/c.txt HTTP/1.1\r\n\r\n"));
+
+    /* the cached ones serve the stale content, the evicted one is loaded
+     * again */
+    eqint(0, _write("a.txt", 'x', 10));
+    eqint(0, _write("b.txt", 'x', 10));
+    eqint(0, _write("c.txt", 'x', 10));
+    eqint(200, request("GET /static/a.txt HTTP/1.1\r\n\r\n"));
+    eqstr("4096", chttp_headerset_get(&r->headers, "Content-Length"));
+    eqint(200, request("GET /static/c.txt HTTP/1.1\r\n\r\n"));
+    eqstr("4096", chttp_headerset_get(&r->headers, "Content-Length"));
+    eqint(200, request("GET /static/b.txt HTTP/1.1\r\n\r\n"));
+    eqstr("10", chttp_headerset_get(&r->headers, "Content-Length"));
+
+    serverfixture_teardown();
+}
+
+
+int
+main() {
+    const char **name;
+
+    if (_setup()) {
+        return EXIT_FAILURE;
+    }
+
+    test_static_get();
+    test_static_range();
+    test_static_assetcache();
+    test_static_assetcache_evict();
+
+    for (name = _assets; *name; name++) {
+        _unlink(*name);
+    }
+    unlink(_escape);
+    unlink(_file);
+    rmdir(_root);
+    return EXIT_SUCCESS;
+}
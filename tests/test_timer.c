@@ -0,0 +1,129 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+/* thirdparty */
+#include <cutest.h>
+
+/* local private */
+#include "timer.h"
+
+
+static int _fired;
+
+
+static void
+_callback(struct timer *t) {
+    _fired++;
+}
+
+
+static void
+test_timer_fire() {
+    struct timerwheel w;
+    struct timer t = {
+        .callback = _callback,
+    };
+
+    _fired = 0;
+    timerwheel_init(&w);
+
+    timer_arm(&w, &t, 3);
+    istrue(timer_armed(&t));
+    timerwheel_advance(&w, 2);
+    eqint(0, _fired);
+    timerwheel_advance(&w, 1);
+    eqint(1, _fired);
+    isfalse(timer_armed(&t));
+
+    /* zero means the next tick */
+    timer_arm(&w, &t, 0);
+    timerwheel_advance(&w, 1);
+    eqint(2, _fired);
+}
+
+
+static void
+test_timer_cascade() {
+    int i;
+    struct timerwheel w;
+    struct timer timers[4];
+    unsigned long ticks[4] = {
+        TIMER_SLOTS - 1,
+        TIMER_SLOTS + 7,
+        TIMER_SLOTS * TIMER_SLOTS + 3,
+        TIMER_SLOTS * TIMER_SLOTS * TIMER_SLOTS + 11,
+    };
+
+    _fired = 0;
+    timerwheel_init(&w);
+
+    /* start from a non-aligned position */
+    timerwheel_advance(&w, 5);
+    for (i = 0; i < 4; i++) {
+        timers[i].callback = _callback;
+        timers[i].pprev = NULL;
+        timer_arm(&w, timers + i, ticks[i]);
+    }
+
+    for (i = 0; i < 4; i++) {
+        timerwheel_advance(&w, ticks[i] - (i? ticks[i - 1]: 0) - 1);
+        eqint(i, _fired);
+        timerwheel_advance(&w, 1);
+        eqint(i + 1, _fired);
+    }
+}
+
+
+static void
+test_timer_cancel() {
+    struct timerwheel w;
+    struct timer t1 = {
+        .callback = _callback,
+    };
+    struct timer t2 = {
+        .callback = _callback,
+    };
+
+    _fired = 0;
+    timerwheel_init(&w);
+
+    timer_arm(&w, &t1, 10);
+    timer_arm(&w, &t2, 10);
+    timer_cancel(&t1);
+    isfalse(timer_armed(&t1));
+
+    /* cancel is idempotent */
+    timer_cancel(&t1);
+
+    /* re-arm */
+    timer_arm(&w, &t2, 20);
+    timerwheel_advance(&w, 10);
+    eqint(0, _fired);
+    timerwheel_advance(&w, 10);
+    eqint(1, _fired);
+}
+
+
+int
+main() {
+    test_timer_fire();
+    test_timer_cascade();
+    test_timer_cancel();
+    return EXIT_SUCCESS;
+}
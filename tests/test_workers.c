@@ -0,0 +1,248 @@
+// Copyright 2025 Vahid Mardani
+/*
+ * This file is part of carrot.
+ *  carrot is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation, either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  carrot is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with carrot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *  Author: Vahid Mardani <vahid.mardani@gmail.com>
+ */
+/* standard */
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <pthread.h>
+
+/* posix */
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/* thirdparty */
+#include <cutest.h>
+
+/* local public */
+#include "carrot/server.h"
+
+/* test private */
+#include "tests/fixtures.h"
+
+
+#define PORT 18741
+#define BIND "127.0.0.1:18741"
+
+
+/* responds the pid of the worker process */
+static int
+_pidA(struct carrot_connection *c, void *ptr) {
+    char pid[16];
+    int len;
+
+    len = snprintf(pid, sizeof(pid), "%d", getpid());
+    ASSRT(0 < carrot_server_responseA(c, 200, NULL, pid, len, 0));
+    return 0;
+}
+
+
+static void *
+_main(void *ptr) {
+    static int ret;
+
+    ret = carrot_server_main(ptr);
+    return &ret;
+}
+
+
+static struct carrot_server *
+_server(struct carrot_server_config *config) {
+    struct carrot_server *s;
+
+    s = carrot_server_new(config);
+    if (s == NULL) {
+        return NULL;
+    }
+
+    if (carrot_server_route(s, CARROT_METHOD_GET, "/", _pidA, NULL)) {
+        carrot_server_free(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+
+/* send a request using a blocking socket and return the response status,
+ * -1 if the server is not listening. the pid of the worker process is
+ * stored if requested. */
+static int
+_get(pid_t *pid) {
+    int fd;
+    int tries;
+    int status;
+    ssize_t bytes;
+    size_t len = 0;
+    char buff[1024];
+    char *body;
+    static const char *req = "GET / HTTP/1.1\r\nConnection: close\r\n\r\n";
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    /* the workers may not be listening yet */
+    for (tries = 0; tries < 100; tries++) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) {
+            return -1;
+        }
+
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            break;
+        }
+
+        close(fd);
+        fd = -1;
+        usleep(10000);
+    }
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (write(fd, req, strlen(req)) != (ssize_t)strlen(req)) {
+        close(fd);
+        return -1;
+    }
+
+    while (len < (sizeof(buff) - 1)) {
+        bytes = read(fd, buff + len, sizeof(buff) - len - 1);
+        if (bytes <= 0) {
+            break;
+        }
+        len += bytes;
+    }
+    close(fd);
+
+    buff[len] = 0;
+    if (sscanf(buff, "HTTP/1.1 %d", &status) != 1) {
+        return -1;
+    }
+
+    body = strstr(buff, "\r\n\r\n");
+    if (pid && body) {
+        *pid = atoi(body + 4);
+    }
+
+    return status;
+}
+
+
+static void
+test_workers() {
+    int i;
+    int *ret;
+    sigset_t set;
+    pthread_t thread;
+    struct carrot_server *s;
+    struct carrot_server_config config = carrot_server_defaultconfig;
+
+    config.bind = BIND;
+    config.workers = 4;
+    s = _server(&config);
+    isnotnull(s);
+
+    /* the signals are received by the server, not by this thread */
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    eqint(0, pthread_sigmask(SIG_BLOCK, &set, NULL));
+    eqint(0, pthread_create(&thread, NULL, _main, s));
+
+    /* served by the workers sharing the port */
+    for (i = 0; i < 32; i++) {
+        eqint(200, _get(NULL));
+    }
+
+    /* all the workers are stopped gracefully */
+    eqint(0, kill(getpid(), SIGTERM));
+    eqint(0, pthread_join(thread, (void **)&ret));
+    eqint(0, *ret);
+    eqint(-1, _get(NULL));
+    eqint(0, pthread_sigmask(SIG_UNBLOCK, &set, NULL));
+}
+
+
+static void
+test_workers_processes() {
+    int i;
+    int status;
+    pid_t master;
+    pid_t pid;
+    pid_t pids[2] = {0, 0};
+    struct carrot_server *s;
+    struct carrot_server_config config = carrot_server_defaultconfig;
+
+    config.bind = BIND;
+    config.processes = 2;
+    s = _server(&config);
+    isnotnull(s);
+
+    master = fork();
+    istrue(master != -1);
+    if (master == 0) {
+        exit(carrot_server_main(s)? EXIT_FAILURE: EXIT_SUCCESS);
+    }
+    carrot_server_free(s);
+
+    /* each worker process accepts on it's own socket */
+    for (i = 0; (i < 256) && (pids[1] == 0); i++) {
+        eqint(200, _get(&pid));
+        istrue(pid != master);
+        if (pids[0] == 0) {
+            pids[0] = pid;
+        }
+        else if (pid != pids[0]) {
+            pids[1] = pid;
+        }
+    }
+    istrue(pids[1] != 0);
+
+    /* the crashed worker is restarted by the master, the connections
+     * queued on it's socket meanwhile are reset */
+    eqint(0, kill(pids[0], SIGKILL));
+    for (i = 0; i < 512; i++) {
+        if ((_get(&pid) == 200) && (pid != pids[0]) && (pid != pids[1])) {
+            break;
+        }
+        usleep(10000);
+    }
+    istrue(i < 512);
+
+    /* forwarded to the workers, which stop gracefully */
+    eqint(0, kill(master, SIGTERM));
+    eqint(master, waitpid(master, &status, 0));
+    istrue(WIFEXITED(status));
+    eqint(EXIT_SUCCESS, WEXITSTATUS(status));
+    eqint(-1, _get(NULL));
+}
+
+
+int
+main() {
+    test_workers_processes();
+    test_workers();
+    return EXIT_SUCCESS;
+}